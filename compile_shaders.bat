@@ -1,3 +0,0 @@
-glslangValidator.exe -V shaders\toy.vert -o shaders\toy.vert.spv
-glslangValidator.exe -V shaders\toy.frag -o shaders\toy.frag.spv
-pause
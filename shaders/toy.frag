@@ -2,12 +2,62 @@
 
 layout (location = 0) out vec4 out_fragColor;
 
+#if defined(DEF_SPECIALIZE_INPUTS)
+// session-constant inputs are specialization constants when DEF_SPECIALIZE_INPUTS
+// is defined by the app, the pipeline is rebuilt when they change
+layout (constant_id = 0) const float iResolutionX_ = 1.0;
+layout (constant_id = 1) const float iResolutionY_ = 1.0;
+layout (constant_id = 2) const float iResolutionZ_ = 1.0;
+layout (constant_id = 3) const float iChannelResolution0X_ = 1.0;
+layout (constant_id = 4) const float iChannelResolution0Y_ = 1.0;
+layout (constant_id = 5) const float iChannelResolution0Z_ = 1.0;
+layout (constant_id = 6) const float iChannelResolution1X_ = 1.0;
+layout (constant_id = 7) const float iChannelResolution1Y_ = 1.0;
+layout (constant_id = 8) const float iChannelResolution1Z_ = 1.0;
+layout (constant_id = 9) const float iChannelResolution2X_ = 1.0;
+layout (constant_id = 10) const float iChannelResolution2Y_ = 1.0;
+layout (constant_id = 11) const float iChannelResolution2Z_ = 1.0;
+layout (constant_id = 12) const float iChannelResolution3X_ = 1.0;
+layout (constant_id = 13) const float iChannelResolution3Y_ = 1.0;
+layout (constant_id = 14) const float iChannelResolution3Z_ = 1.0;
+layout (constant_id = 15) const float iSampleRate_ = 44100.0;
+
+const vec4 iResolution = vec4(iResolutionX_, iResolutionY_, iResolutionZ_, 0.0);
+const vec4 iChannelResolution[4] = vec4[4](
+    vec4(iChannelResolution0X_, iChannelResolution0Y_, iChannelResolution0Z_, 0.0),
+    vec4(iChannelResolution1X_, iChannelResolution1Y_, iChannelResolution1Z_, 0.0),
+    vec4(iChannelResolution2X_, iChannelResolution2Y_, iChannelResolution2Z_, 0.0),
+    vec4(iChannelResolution3X_, iChannelResolution3Y_, iChannelResolution3Z_, 0.0));
+#else
+// updated when the channel images change
 layout (std140, set = 0, binding = 0) readonly uniform u_uniformBuffer
 {
     vec4 iChannelResolution[4];
+};
+#endif
+
+// user parameters, float or vec members with values by name from shaders/params.txt
+// (updated when the file is saved, without recompiling)
+layout (std140, set = 0, binding = 1) readonly uniform u_params
+{
+    vec4 iParam0;
+    vec4 iParam1;
+};
+
+// updated every frame, written to the uniform buffer slot of the frame so the draw commands
+// are recorded once; push constants when DEF_PUSH_CONSTANT_INPUTS is defined by the app
+// (the members are vec4s, so both layouts have the same offsets)
+#if defined(DEF_PUSH_CONSTANT_INPUTS)
+layout (std430, push_constant) uniform u_pushConstants
+#else
+layout (std140, set = 0, binding = 2) readonly uniform u_frameInputs
+#endif
+{
     vec4 iMouse;
     vec4 iDate;
+#if !defined(DEF_SPECIALIZE_INPUTS)
     vec4 iResolution;
+#endif
 
     vec4 iChannelTime;
 
@@ -18,15 +68,53 @@ layout (std140, set = 0, binding = 0) readonly uniform u_uniformBuffer
     vec4 globalVariables_;
 };
 
+// DEF_CHANNEL[0-3]_CUBE and DEF_CHANNEL[0-3]_3D are defined by the app
+// for cube map (channel0_px.png ... channel0_nz.png) and volume (channel0.vol) channels
+#if defined(DEF_CHANNEL0_CUBE)
+layout(set = 1, binding = 0) uniform samplerCube iChannel0;
+#elif defined(DEF_CHANNEL0_3D)
+layout(set = 1, binding = 0) uniform sampler3D iChannel0;
+#else
 layout(set = 1, binding = 0) uniform sampler2D iChannel0;
+#endif
+#if defined(DEF_CHANNEL1_CUBE)
+layout(set = 1, binding = 1) uniform samplerCube iChannel1;
+#elif defined(DEF_CHANNEL1_3D)
+layout(set = 1, binding = 1) uniform sampler3D iChannel1;
+#else
 layout(set = 1, binding = 1) uniform sampler2D iChannel1;
+#endif
+#if defined(DEF_CHANNEL2_CUBE)
+layout(set = 1, binding = 2) uniform samplerCube iChannel2;
+#elif defined(DEF_CHANNEL2_3D)
+layout(set = 1, binding = 2) uniform sampler3D iChannel2;
+#else
 layout(set = 1, binding = 2) uniform sampler2D iChannel2;
+#endif
+#if defined(DEF_CHANNEL3_CUBE)
+layout(set = 1, binding = 3) uniform samplerCube iChannel3;
+#elif defined(DEF_CHANNEL3_3D)
+layout(set = 1, binding = 3) uniform sampler3D iChannel3;
+#else
 layout(set = 1, binding = 3) uniform sampler2D iChannel3;
+#endif
+
+// texture array of texture0.png ... texture63.png, empty slots are transparent black,
+// switching textures is an index change, e.g. texture(iTextures[index], uv)
+// (a non-constant index needs shaderSampledImageArrayDynamicIndexing)
+#if !defined(DEF_TEXTURE_ARRAY_SIZE)
+#define DEF_TEXTURE_ARRAY_SIZE 64
+#endif
+layout(set = 1, binding = 4) uniform sampler2D iTextures[DEF_TEXTURE_ARRAY_SIZE];
 
 #define iGlobalDelta    globalVariables_.x
 #define iGlobalFrame    globalVariables_.y
 #define iGlobalTime     globalVariables_.z
+#if defined(DEF_SPECIALIZE_INPUTS)
+#define iSampleRate     iSampleRate_
+#else
 #define iSampleRate     globalVariables_.w
+#endif
 
 #define texture2D       texture
 
@@ -37,12 +125,17 @@ layout(set = 1, binding = 3) uniform sampler2D iChannel3;
 
 #define gl_FragColor    out_fragColor
 
-#define DEF_USE_IMAGE_SHADER                1
+// Switches are specialization constants, presets.txt overrides them by name
+// and the number keys select a preset without recompiling.
+layout (constant_id = 100) const bool specUseImageShader = true;
 
 // shadertoy shaders usually correct for gamma in the shader code
 // we have a real sRGB target and need to write a linear color
-// if you do not want to compensate uncomment this define
-#define DEF_USE_SRGB_TO_LINEAR_CONVERSION   1
+// if you do not want to compensate set this to false
+layout (constant_id = 101) const bool specUseSrgbToLinearConversion = true;
+
+// quality knob for the shader code: 0 low, 1 medium, 2 high
+layout (constant_id = 102) const int specQuality = 1;
 
 ///////////////////////////////////////////////////////////////////////////////
 // SHADERTOY SHADER HERE
@@ -94,13 +187,15 @@ vec3 sRgbToLinearVec(const vec3 sRgbColor)
 
 void main(void)
 {
-#if (DEF_USE_IMAGE_SHADER == 1)
-    mainImage(out_fragColor, vec2(gl_FragCoord.x, iResolution.y - gl_FragCoord.y));
-#endif
+    if (specUseImageShader)
+    {
+        mainImage(out_fragColor, vec2(gl_FragCoord.x, iResolution.y - gl_FragCoord.y));
+    }
 
-#if (DEF_USE_SRGB_TO_LINEAR_CONVERSION == 1)
-    out_fragColor.rgb = sRgbToLinearVec(out_fragColor.rgb);
-#endif
+    if (specUseSrgbToLinearConversion)
+    {
+        out_fragColor.rgb = sRgbToLinearVec(out_fragColor.rgb);
+    }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
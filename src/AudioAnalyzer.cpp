@@ -0,0 +1,350 @@
+// Copyright (c) 2017 Johannes Pystynen
+// This code is licensed under the MIT license (MIT)
+
+#include "AudioAnalyzer.h"
+
+#include "GfxResources.h"
+#include "GpuBuffer.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+
+const float c_smoothingTimeConstant = 0.8f;
+const float c_minDecibels           = -100.0f;
+const float c_maxDecibels           = -30.0f;
+
+uint32_t readU32(const uint8_t* p_src)
+{
+    return (uint32_t)p_src[0] | ((uint32_t)p_src[1] << 8) |
+        ((uint32_t)p_src[2] << 16) | ((uint32_t)p_src[3] << 24);
+}
+
+uint16_t readU16(const uint8_t* p_src)
+{
+    return (uint16_t)(p_src[0] | (p_src[1] << 8));
+}
+
+} // namespace
+
+namespace core
+{
+
+AudioAnalyzer::AudioAnalyzer(GfxDevice* const p_gfxDevice,
+    const std::string& filename,
+    const uint32_t inFlightFrameCount)
+    : m_file(filename, std::ios::binary),
+    m_fft(c_fftSize)
+{
+    assert(p_gfxDevice);
+
+    m_valid = m_file.is_open() && loadWaveHeader();
+    if (!m_valid)
+    {
+        std::cerr << "unsupported or invalid wave file: " << filename << std::endl;
+        return;
+    }
+
+    // same analysis as the Web Audio AnalyserNode used by Shadertoy
+    const double pi = 3.14159265358979323846;
+    m_window.resize(c_fftSize);
+    for (uint32_t idx = 0; idx < c_fftSize; ++idx)
+    {
+        const double x = (double)idx / (double)c_fftSize;
+        m_window[idx] = (float)(0.42 - 0.5 * std::cos(2.0 * pi * x) + 0.08 * std::cos(4.0 * pi * x));
+    }
+    m_samples.resize(c_fftSize);
+    m_re.resize(c_fftSize);
+    m_im.resize(c_fftSize);
+    m_smoothed.resize(c_fftSize / 2, 0.0f);
+
+    // a slot per frame in flight, one being analyzed and one ready for the next frame
+    m_slots.resize(inFlightFrameCount + 2);
+    for (auto&& slotRef : m_slots)
+    {
+        slotRef.stagingBuffer.reset(new GpuBufferStaging(p_gfxDevice, c_textureWidth * c_textureHeight));
+        slotRef.p_data = slotRef.stagingBuffer->map();
+    }
+
+    // silence until the first analysis is ready
+    std::memset(m_slots[0].p_data, 0, c_textureWidth);
+    std::memset(m_slots[0].p_data + c_textureWidth, 128, c_textureWidth);
+    m_slots[0].state = SlotState::ready;
+    m_readySlot = 0;
+
+    m_worker = std::thread(&AudioAnalyzer::analyzeLoop, this);
+}
+
+AudioAnalyzer::~AudioAnalyzer()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_condition.notify_one();
+    if (m_worker.joinable())
+    {
+        m_worker.join();
+    }
+}
+
+bool AudioAnalyzer::isValid() const
+{
+    return m_valid;
+}
+
+uint32_t AudioAnalyzer::getSampleRate() const
+{
+    return m_sampleRate;
+}
+
+int32_t AudioAnalyzer::acquireFrame(const float timeSeconds)
+{
+    int32_t acquiredSlot = -1;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // the result for this time is picked up by the next frame
+        m_requestTime = timeSeconds;
+        ++m_requestCount;
+
+        if (m_readySlot >= 0)
+        {
+            acquiredSlot = m_readySlot;
+            m_readySlot = -1;
+            m_slots[acquiredSlot].state = SlotState::inUse;
+        }
+    }
+    m_condition.notify_one();
+    return acquiredSlot;
+}
+
+void AudioAnalyzer::releaseFrame(const int32_t slot)
+{
+    assert(slot >= 0 && slot < (int32_t)m_slots.size());
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        assert(m_slots[slot].state == SlotState::inUse);
+        m_slots[slot].state = SlotState::free;
+    }
+    m_condition.notify_one();
+}
+
+GpuBufferStaging* AudioAnalyzer::getStagingBuffer(const int32_t slot)
+{
+    assert(slot >= 0 && slot < (int32_t)m_slots.size());
+    return m_slots[slot].stagingBuffer.get();
+}
+
+bool AudioAnalyzer::loadWaveHeader()
+{
+    uint8_t header[12];
+    if (!m_file.read((char*)header, sizeof(header))
+        || std::memcmp(header, "RIFF", 4) != 0
+        || std::memcmp(header + 8, "WAVE", 4) != 0)
+    {
+        return false;
+    }
+
+    bool formatFound = false;
+    uint16_t formatTag = 0;
+    uint16_t bitsPerSample = 0;
+
+    uint8_t chunkHeader[8];
+    while (m_file.read((char*)chunkHeader, sizeof(chunkHeader)))
+    {
+        const uint32_t chunkSize = readU32(chunkHeader + 4);
+        const std::streamoff chunkStart = m_file.tellg();
+
+        if (std::memcmp(chunkHeader, "fmt ", 4) == 0)
+        {
+            if (chunkSize < 16 || chunkSize > c_maxFormatChunkSize)
+            {
+                return false;
+            }
+            std::vector<uint8_t> fmt(chunkSize);
+            if (!m_file.read((char*)fmt.data(), chunkSize))
+            {
+                return false;
+            }
+            formatTag       = readU16(&fmt[0]);
+            m_channelCount  = readU16(&fmt[2]);
+            m_sampleRate    = readU32(&fmt[4]);
+            bitsPerSample   = readU16(&fmt[14]);
+
+            // WAVE_FORMAT_EXTENSIBLE, format tag is in the sub format guid
+            if (formatTag == 0xfffe && chunkSize >= 26)
+            {
+                formatTag = readU16(&fmt[24]);
+            }
+            formatFound = true;
+        }
+        else if (std::memcmp(chunkHeader, "data", 4) == 0 && formatFound)
+        {
+            if (formatTag == 1 && bitsPerSample == 8)
+            {
+                m_sampleFormat = SampleFormat::pcm8;
+            }
+            else if (formatTag == 1 && bitsPerSample == 16)
+            {
+                m_sampleFormat = SampleFormat::pcm16;
+            }
+            else if (formatTag == 3 && bitsPerSample == 32)
+            {
+                m_sampleFormat = SampleFormat::float32;
+            }
+            else
+            {
+                return false;
+            }
+            if (m_channelCount == 0 || m_sampleRate == 0)
+            {
+                return false;
+            }
+
+            m_frameByteSize = m_channelCount * bitsPerSample / 8;
+            m_dataOffset = (uint64_t)chunkStart;
+            m_frameCount = chunkSize / m_frameByteSize;
+            return m_frameCount > 0;
+        }
+
+        // chunks are padded to even size
+        m_file.seekg(chunkStart + (std::streamoff)chunkSize + (chunkSize & 1), std::ios::beg);
+    }
+    return false;
+}
+
+void AudioAnalyzer::analyzeLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stop)
+    {
+        auto slotIter = std::find_if(m_slots.begin(), m_slots.end(),
+            [](const Slot& slot) { return slot.state == SlotState::free; });
+        if (m_analyzedCount == m_requestCount || slotIter == m_slots.end())
+        {
+            m_condition.wait(lock);
+            continue;
+        }
+
+        // only the newest time is analyzed, older requests are dropped
+        const float time = m_requestTime;
+        const uint64_t request = m_requestCount;
+        const uint32_t slot = (uint32_t)(slotIter - m_slots.begin());
+        slotIter->state = SlotState::analyzing;
+
+        lock.unlock();
+        readWindow((int64_t)std::floor((double)time * (double)m_sampleRate));
+        analyze(m_slots[slot].p_data);
+        lock.lock();
+
+        // replace a ready slot nobody has acquired yet
+        if (m_readySlot >= 0)
+        {
+            m_slots[m_readySlot].state = SlotState::free;
+        }
+        m_slots[slot].state = SlotState::ready;
+        m_slots[slot].request = request;
+        m_readySlot = (int32_t)slot;
+        m_analyzedCount = request;
+    }
+}
+
+void AudioAnalyzer::readWindow(const int64_t endFrame)
+{
+    // window of c_fftSize frames ending at endFrame, looping the file
+    const int64_t startFrame = endFrame - (int64_t)c_fftSize;
+    std::fill(m_samples.begin(), m_samples.end(), 0.0f);
+
+    uint32_t sampleIdx = 0;
+    if (startFrame < 0)
+    {
+        sampleIdx = (uint32_t)std::min<int64_t>(-startFrame, c_fftSize);
+    }
+
+    m_readBuffer.resize(c_fftSize * m_frameByteSize);
+    while (sampleIdx < c_fftSize)
+    {
+        const uint64_t frame = (uint64_t)(startFrame + sampleIdx) % m_frameCount;
+        const uint32_t readCount = (uint32_t)std::min<uint64_t>(c_fftSize - sampleIdx, m_frameCount - frame);
+
+        m_file.clear();
+        m_file.seekg((std::streamoff)(m_dataOffset + frame * m_frameByteSize), std::ios::beg);
+        if (!m_file.read((char*)m_readBuffer.data(), readCount * m_frameByteSize))
+        {
+            return;
+        }
+
+        const float channelScale = 1.0f / (float)m_channelCount;
+        for (uint32_t idx = 0; idx < readCount; ++idx)
+        {
+            const uint8_t* p_frame = &m_readBuffer[idx * m_frameByteSize];
+            float sum = 0.0f;
+            for (uint32_t ch = 0; ch < m_channelCount; ++ch)
+            {
+                switch (m_sampleFormat)
+                {
+                case SampleFormat::pcm8:
+                    sum += ((float)p_frame[ch] - 128.0f) / 128.0f;
+                    break;
+                case SampleFormat::pcm16:
+                    sum += (float)(int16_t)readU16(p_frame + ch * 2) / 32768.0f;
+                    break;
+                case SampleFormat::float32:
+                {
+                    float value;
+                    std::memcpy(&value, p_frame + ch * 4, sizeof(value));
+                    sum += value;
+                    break;
+                }
+                }
+            }
+            m_samples[sampleIdx + idx] = sum * channelScale;
+        }
+        sampleIdx += readCount;
+    }
+}
+
+void AudioAnalyzer::analyze(uint8_t* const p_dst)
+{
+    for (uint32_t idx = 0; idx < c_fftSize; ++idx)
+    {
+        m_re[idx] = m_samples[idx] * m_window[idx];
+        m_im[idx] = 0.0f;
+    }
+    m_fft.forward(m_re.data(), m_im.data());
+
+    // first row: spectrum in decibels mapped to [0, 255]
+    const float magnitudeScale = 1.0f / (float)c_fftSize;
+    const float decibelScale = 255.0f / (c_maxDecibels - c_minDecibels);
+    for (uint32_t idx = 0; idx < c_textureWidth; ++idx)
+    {
+        const float magnitude = std::sqrt(m_re[idx] * m_re[idx] + m_im[idx] * m_im[idx]) * magnitudeScale;
+        m_smoothed[idx] = c_smoothingTimeConstant * m_smoothed[idx] + (1.0f - c_smoothingTimeConstant) * magnitude;
+
+        const float decibels = m_smoothed[idx] > 0.0f ? 20.0f * std::log10(m_smoothed[idx]) : c_minDecibels;
+        const float value = (decibels - c_minDecibels) * decibelScale;
+        p_dst[idx] = (uint8_t)std::min(255.0f, std::max(0.0f, value));
+    }
+
+    // second row: the newest samples of the window
+    const float* p_wave = &m_samples[c_fftSize - c_textureWidth];
+    for (uint32_t idx = 0; idx < c_textureWidth; ++idx)
+    {
+        const float value = 128.0f * (p_wave[idx] + 1.0f);
+        p_dst[c_textureWidth + idx] = (uint8_t)std::min(255.0f, std::max(0.0f, value));
+    }
+}
+
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,122 @@
+#ifndef CORE_AUDIO_ANALYZER_H
+#define CORE_AUDIO_ANALYZER_H
+
+// Copyright (c) 2017 Johannes Pystynen
+// This code is licensed under the MIT license (MIT)
+
+#include "Fft.h"
+#include "ImageStream.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace core
+{
+
+class GfxDevice;
+class GpuBufferStaging;
+
+// Analyzes a WAV file as a Shadertoy style audio channel: 512x2 R8 image,
+// first row is the fft spectrum and the second row the waveform at the time.
+// Samples are streamed from the file and analyzed on a worker thread.
+class AudioAnalyzer : public ImageStream
+{
+public:
+    static const uint32_t c_textureWidth    = 512;
+    static const uint32_t c_textureHeight   = 2;
+
+    // inFlightFrameCount is the number of frames which can hold an acquired slot at once.
+    AudioAnalyzer(GfxDevice* const p_gfxDevice,
+        const std::string& filename,
+        const uint32_t inFlightFrameCount);
+    ~AudioAnalyzer() override;
+
+    AudioAnalyzer(const AudioAnalyzer&) = delete;
+    AudioAnalyzer& operator=(const AudioAnalyzer&) = delete;
+
+    bool isValid() const;
+    uint32_t getSampleRate() const;
+
+    int32_t acquireFrame(const float timeSeconds) override;
+    void releaseFrame(const int32_t slot) override;
+
+    GpuBufferStaging* getStagingBuffer(const int32_t slot) override;
+
+private:
+    static const uint32_t c_fftSize             = 2048; // 1024 bins, the lowest 512 are used
+    static const uint32_t c_maxFormatChunkSize  = 64;   // WAVEFORMATEXTENSIBLE is 40 bytes
+
+    bool loadWaveHeader();
+    void analyzeLoop();
+    void readWindow(const int64_t endFrame);
+    void analyze(uint8_t* const p_dst);
+
+    enum class SlotState : uint32_t
+    {
+        free        = 0,
+        analyzing   = 1,
+        ready       = 2,
+        inUse       = 3,
+    };
+
+    struct Slot
+    {
+        std::unique_ptr<GpuBufferStaging> stagingBuffer;
+        uint8_t* p_data = nullptr;  // persistently mapped
+
+        SlotState state = SlotState::free;
+        uint64_t request = 0;
+    };
+
+    // wave format
+    enum class SampleFormat : uint32_t
+    {
+        pcm8        = 0,
+        pcm16       = 1,
+        float32     = 2,
+    };
+
+    std::ifstream m_file;
+    bool m_valid                = false;
+    SampleFormat m_sampleFormat = SampleFormat::pcm16;
+    uint32_t m_sampleRate       = 0;
+    uint32_t m_channelCount     = 0;
+    uint32_t m_frameByteSize    = 0;    // bytes per sample frame (all channels)
+    uint64_t m_dataOffset       = 0;
+    uint64_t m_frameCount       = 0;
+
+    // worker data
+    Fft m_fft;
+    std::vector<float> m_window;        // Blackman window
+    std::vector<float> m_samples;       // mono, [-1, 1]
+    std::vector<float> m_re;
+    std::vector<float> m_im;
+    std::vector<float> m_smoothed;      // smoothed spectrum magnitudes
+    std::vector<uint8_t> m_readBuffer;
+
+    std::vector<Slot> m_slots;
+    int32_t m_readySlot     = -1;   // newest analyzed slot
+
+    float m_requestTime     = 0.0f;
+    uint64_t m_requestCount = 0;    // incremented for each new time
+    uint64_t m_analyzedCount= 0;
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::thread m_worker;
+    bool m_stop = false;
+};
+
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif // CORE_AUDIO_ANALYZER_H
@@ -8,7 +8,7 @@
 
 #include <cstdint>
 #include <assert.h>
-#include <map>
+#include <vector>
 
 #include <vulkan/vulkan.h>
 
@@ -20,40 +20,23 @@ namespace core
 class DescriptorSet
 {
 public:
+    // Layout bindings are usually from shader reflection, empty sets are allowed.
     DescriptorSet(GfxDevice* const p_gfxDevice,
         VkDescriptorPool descriptorPool,
-        const uint32_t bindingCount,
-        const VkDescriptorType descriptorType,
-        const VkShaderStageFlags shaderStageFlags)
+        const std::vector<VkDescriptorSetLayoutBinding>& bindings)
         : mp_gfxDevice(p_gfxDevice),
-        m_descriptorPool(descriptorPool),
-        m_bindingCount(bindingCount),
-        m_descriptorType(descriptorType)
+        m_descriptorPool(descriptorPool)
     {
         assert(mp_gfxDevice);
         assert(mp_gfxDevice->logicalDevice);
 
-        std::vector<VkDescriptorSetLayoutBinding> descriptorSetLayoutBindingArray(bindingCount);
-        for (uint32_t idx = 0; idx < m_bindingCount; ++idx)
-        {
-            const VkDescriptorSetLayoutBinding descriptorSetLayoutBinding =
-            {
-                idx,                // binding
-                m_descriptorType,   // descriptorType
-                1,                  // descriptorCount
-                shaderStageFlags,   // stageFlags
-                nullptr             // pImmutableSamplers
-            };
-            descriptorSetLayoutBindingArray[idx] = descriptorSetLayoutBinding;
-        }
-
         const VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo =
         {
             VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,    // sType
             nullptr,                                                // pNext
             0,                                                      // flags
-            m_bindingCount,                                         // bindingCount
-            descriptorSetLayoutBindingArray.data(),                 // pBindings
+            (uint32_t)bindings.size(),                              // bindingCount
+            bindings.data(),                                        // pBindings
         };
 
         CHECK_VK_RESULT_SUCCESS(vkCreateDescriptorSetLayout(
@@ -104,9 +87,6 @@ public:
 private:
     GfxDevice* const mp_gfxDevice           = nullptr;
     VkDescriptorPool const m_descriptorPool = nullptr;
-
-    uint32_t m_bindingCount             = 0;
-    VkDescriptorType m_descriptorType   = VK_DESCRIPTOR_TYPE_MAX_ENUM;
 };
 
 } // namespace
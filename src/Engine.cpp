@@ -4,7 +4,10 @@
 #include "Engine.h"
 
 #include "GfxResources.h"
+#include "HeapAllocationCheck.h"
+#include "JobSystem.h"
 #include "Renderer.h"
+#include "ShaderCompiler.h"
 #include "Window.h"
 #include "Utils.h"
 #include "Timer.h"
@@ -12,16 +15,65 @@
 #include "FileDirectoryWatcher.h"
 #include "ResourceList.h"
 
+#include <cstdio>
+#include <iomanip>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <ctime>
 #include <chrono>
+#include <exception>
+#include <functional>
+#include <thread>
+#include <utility>
+#include <vector>
 
 ///////////////////////////////////////////////////////////////////////////////
 
 namespace core
 {
 
+static double getMillisecondsSince(const std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Durations of the startup phases, phases may run on any thread.
+class StartupPhases
+{
+public:
+    std::function<void()> timed(const std::string& name, std::function<void()>&& func)
+    {
+        return [this, name, func]()
+        {
+            const auto start = std::chrono::steady_clock::now();
+            func();
+            const double milliseconds = getMillisecondsSince(start);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_phases.emplace_back(name, milliseconds);
+        };
+    }
+
+    void print(const double totalMilliseconds)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::cout << "Startup phases:" << std::endl << std::fixed << std::setprecision(1);
+        for (const auto& phaseRef : m_phases)
+        {
+            std::cout << "    " << std::left << std::setw(24) << phaseRef.first
+                << std::right << std::setw(8) << phaseRef.second << " ms" << std::endl;
+        }
+        std::cout << "    " << std::left << std::setw(24) << "total"
+            << std::right << std::setw(8) << totalMilliseconds << " ms" << std::endl;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::vector<std::pair<std::string, double> > m_phases; // in completion order
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
 Engine::Engine()
 {
 
@@ -29,7 +81,7 @@ Engine::Engine()
 
 Engine::~Engine()
 {
-
+    stopRenderThread();
 }
 
 void Engine::init()
@@ -38,80 +90,243 @@ void Engine::init()
     gv.applicationName = "VulkanToy";
     gv.engineName = "ToyEngine";
 
-    m_window = std::unique_ptr<Window>(new Window(gv.windowWidth, gv.windowHeight, gv.applicationName));
+    m_startTime = std::chrono::steady_clock::now();
+    StartupPhases phases;
 
-    m_gfxResources = std::unique_ptr<GfxResources>(new GfxResources(m_window.get()));
-    m_renderer = std::unique_ptr<Renderer>(new Renderer(
-        m_gfxResources.get(), m_window.get()));
+    m_shaderCompilerProcess = std::unique_ptr<ShaderCompilerProcess>(new ShaderCompilerProcess());
+    m_jobSystem = std::unique_ptr<JobSystem>(new JobSystem());
 
-    m_imageDirWatcher.reset(new FileDirectoryWatcher(
-        ResourceList::getInstance().imagePath,
-        ResourceList::getInstance().imageFilesForSearch,
-        true));
-    m_shaderDirWatcher.reset(new FileDirectoryWatcher(
-        ResourceList::getInstance().shaderPath,
-        ResourceList::getInstance().shaderFiles,
-        false));
+    // the window is created on the main thread which pumps its messages
+    phases.timed("window", [this, &gv]()
+    {
+        m_window = std::unique_ptr<Window>(new Window(gv.windowWidth, gv.windowHeight, gv.applicationName));
+    })();
+
+    // instance and device creation is the longest phase, work not needing the device runs meanwhile
+    RendererStartup rendererStartup;
+    const JobSystem::JobHandle deviceJob =
+        m_jobSystem->run(phases.timed("instance and device", [this]()
+    {
+        m_gfxResources = std::unique_ptr<GfxResources>(new GfxResources(m_window.get()));
+    }));
+    const JobSystem::JobHandle compileJob =
+        m_jobSystem->run(phases.timed("glsl compile", [this, &rendererStartup]()
+    {
+        rendererStartup.compileShaders(m_jobSystem.get());
+    }));
+    const JobSystem::JobHandle pipelineCacheJob =
+        m_jobSystem->run(phases.timed("pipeline cache load", [&rendererStartup]()
+    {
+        rendererStartup.loadPipelineCache();
+    }));
+
+    // the renderer needs the device and the reflection of the compiled shader: only the channels
+    // the shader samples are decoded, straight to staging buffers while the renderer creates
+    // its device objects
+    const std::vector<JobSystem::JobHandle> startupJobs
+    {
+        m_jobSystem->run(phases.timed("renderer and image decode", [this, &rendererStartup]()
+        {
+            m_renderer = std::unique_ptr<Renderer>(new Renderer(
+                m_gfxResources.get(), m_window.get(), m_jobSystem.get(), rendererStartup));
+        }), { deviceJob, compileJob, pipelineCacheJob }),
+        m_jobSystem->run(phases.timed("file watchers", [this]()
+        {
+            m_imageDirWatcher.reset(new FileDirectoryWatcher(
+                ResourceList::getInstance().imagePath,
+                ResourceList::getInstance().getImageWatchPatterns()));
+            m_shaderDirWatcher.reset(new FileDirectoryWatcher(
+                ResourceList::getInstance().shaderPath,
+                ResourceList::getInstance().shaderWatchPatterns));
+            m_paramFileWatcher.reset(new FileDirectoryWatcher(
+                ResourceList::getInstance().shaderPath,
+                { ResourceList::getInstance().paramFile, ResourceList::getInstance().presetFile }));
+        })),
+    };
+    // a failed device creation skips the renderer job and is rethrown here
+    m_jobSystem->wait(startupJobs);
+
+    phases.print(getMillisecondsSince(m_startTime));
 }
 
 void Engine::run()
 {
-    while (!m_window->shouldClose())
-    {
-        m_window->update();
-        m_timer.update();
+    m_renderThread = std::thread(&Engine::renderLoop, this);
 
-        RendererInput rendererInput = std::move(getRendererInput());
+    while (!m_window->shouldClose() && !m_renderThreadDone)
+    {
+        m_window->waitForMessages(1);
 
-        if (m_timer.isFpsUpdated())
+        // steady-state part of the loop, file changes below may allocate
         {
-            m_window->updateWindowText("    " + std::to_string(round(m_timer.timeSeconds))
-                + "    " + std::to_string(m_timer.fps) + " fps");
+            NoHeapAllocationScope noHeapAllocationScope;
+
+            m_window->update();
+            m_mousePos.store(m_window->getMousePos());
+
+            if (m_fpsUpdated.exchange(false))
+            {
+                char text[128];
+#ifdef _DEBUG
+                // frame loop memory use, the heap allocation count should stay 0
+                snprintf(text, sizeof(text), "    %.0f    %.0f fps    arena %zu B    %llu allocs",
+                    m_timeSeconds.load(), m_fps.load(), m_frameArenaHighWaterMark.load(),
+                    (unsigned long long)getFrameHeapAllocationCount());
+#else
+                snprintf(text, sizeof(text), "    %.0f    %.0f fps",
+                    m_timeSeconds.load(), m_fps.load());
+#endif
+                m_window->updateWindowText(text);
+            }
         }
 
         if (m_window->isResized())
         {
-            m_gfxResources->resizeWindow();
-            m_renderer->resizeFramebuffer();
+            RenderCommand command;
+            command.type = RenderCommand::Type::resize;
+            pushRenderCommand(std::move(command));
             m_window->resizeHandled();
         }
         if (m_imageDirWatcher->checkForChanges())
         {
-            const std::vector<std::string> files =
-                std::move(m_imageDirWatcher->getChangedFilesAndReset());
-            if (files.size() > 0)
+            RenderCommand command;
+            command.type = RenderCommand::Type::updateImages;
+            command.files = std::move(m_imageDirWatcher->getChangedFilesAndReset());
+            if (command.files.size() > 0)
             {
-                m_renderer->updateImages(files);
+                pushRenderCommand(std::move(command));
             }
         }
         if (m_shaderDirWatcher->checkForChanges())
         {
-            const std::vector<std::string> files =
-                std::move(m_shaderDirWatcher->getChangedFilesAndReset());
-            if (files.size() > 0)
+            RenderCommand command;
+            command.type = RenderCommand::Type::updateShaders;
+            command.files = std::move(m_shaderDirWatcher->getChangedFilesAndReset());
+            if (command.files.size() > 0)
             {
-                m_renderer->updateShaders(files);
+                pushRenderCommand(std::move(command));
             }
         }
+        const int32_t presetKey = m_window->takePresetKey();
+        if (presetKey >= 0)
+        {
+            RenderCommand command;
+            command.type = RenderCommand::Type::selectPreset;
+            command.presetIndex = (uint32_t)presetKey;
+            pushRenderCommand(std::move(command));
+        }
+        if (m_paramFileWatcher->checkForChanges()
+            && m_paramFileWatcher->getChangedFilesAndReset().size() > 0)
+        {
+            RenderCommand command;
+            command.type = RenderCommand::Type::updateParams;
+            pushRenderCommand(std::move(command));
+        }
+    }
 
-        m_renderer->render(rendererInput);
-        m_frameIndex++;
+    stopRenderThread();
+    if (m_renderException)
+    {
+        std::rethrow_exception(m_renderException);
     }
 }
 
-RendererInput Engine::getRendererInput()
+void Engine::renderLoop()
 {
-    RendererInput rendererInput{};
-    rendererInput.globalTime    = m_timer.timeSeconds;
-    rendererInput.deltaTime     = m_timer.deltaTimeSeconds;
-    rendererInput.frameIndex    = m_frameIndex;
-    rendererInput.mousePos      = m_window->getMousePos();
-    rendererInput.date[0]       = m_timer.year;
-    rendererInput.date[1]       = m_timer.month;
-    rendererInput.date[2]       = m_timer.day;
-    rendererInput.date[3]       = m_timer.secs;
-
-    return rendererInput;
+    try
+    {
+        RendererInput rendererInput{};
+        for (;;)
+        {
+            RenderCommand command;
+            while (m_renderQueue.tryPop(command))
+            {
+                switch (command.type)
+                {
+                case RenderCommand::Type::resize:
+                    m_gfxResources->resizeWindow();
+                    m_renderer->resizeFramebuffer();
+                    break;
+                case RenderCommand::Type::updateImages:
+                    m_renderer->updateImages(command.files);
+                    break;
+                case RenderCommand::Type::updateShaders:
+                    m_renderer->updateShaders(command.files);
+                    break;
+                case RenderCommand::Type::updateParams:
+                    m_renderer->updateParams();
+                    break;
+                case RenderCommand::Type::selectPreset:
+                    m_renderer->selectPreset(command.presetIndex);
+                    break;
+                case RenderCommand::Type::stop:
+                    m_gfxResources->waitForIdle();
+                    m_renderThreadDone = true;
+                    return;
+                }
+            }
+
+            // steady-state frame, heap allocations are asserted in debug builds
+            {
+                NoHeapAllocationScope noHeapAllocationScope;
+
+                m_timer.update();
+                if (m_timer.isFpsUpdated())
+                {
+                    m_fps = m_timer.fps;
+                    m_timeSeconds = m_timer.timeSeconds;
+                    m_frameArenaHighWaterMark = m_renderer->getFrameArenaHighWaterMark();
+                    m_fpsUpdated = true;
+                }
+
+                rendererInput.mousePos      = m_mousePos.load();
+                rendererInput.globalTime    = m_timer.timeSeconds;
+                rendererInput.deltaTime     = m_timer.deltaTimeSeconds;
+                rendererInput.frameIndex    = m_frameIndex;
+                rendererInput.date[0]       = m_timer.year;
+                rendererInput.date[1]       = m_timer.month;
+                rendererInput.date[2]       = m_timer.day;
+                rendererInput.date[3]       = m_timer.secs;
+
+                m_renderer->render(rendererInput);
+            }
+            if (m_frameIndex == 0)
+            {
+                std::cout << "First frame submitted " << std::fixed << std::setprecision(1)
+                    << getMillisecondsSince(m_startTime) << " ms after start" << std::endl;
+            }
+            m_frameIndex++;
+        }
+    }
+    catch (...)
+    {
+        m_renderException = std::current_exception();
+    }
+    m_renderThreadDone = true;
+}
+
+void Engine::pushRenderCommand(RenderCommand&& command)
+{
+    // control commands are never dropped
+    while (!m_renderQueue.tryPush(std::move(command)))
+    {
+        if (m_renderThreadDone)
+        {
+            return;
+        }
+        std::this_thread::yield();
+    }
+}
+
+void Engine::stopRenderThread()
+{
+    if (m_renderThread.joinable())
+    {
+        RenderCommand command;
+        command.type = RenderCommand::Type::stop;
+        pushRenderCommand(std::move(command));
+        m_renderThread.join();
+    }
 }
 
 } // namespace
@@ -4,9 +4,17 @@
 // Copyright (c) 2017 Johannes Pystynen
 // This code is licensed under the MIT license (MIT)
 
+#include "Renderer.h"
+#include "SpscQueue.h"
 #include "Timer.h"
 
+#include <atomic>
+#include <chrono>
+#include <exception>
 #include <memory>
+#include <string>
+#include <thread>
+#include <vector>
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -15,8 +23,8 @@ namespace core
 
 class FileDirectoryWatcher;
 class GfxResources;
-class Renderer;
-class RendererInput;
+class JobSystem;
+class ShaderCompilerProcess;
 class Window;
 
 class Engine
@@ -28,11 +36,41 @@ public:
     Engine(const Engine&) = delete;
     Engine& operator=(const Engine&) = delete;
 
+    // Independent startup phases (device creation, shader compiling,
+    // pipeline cache loading) run in parallel, phase times are printed.
     void init();
     void run();
 
 private:
-    RendererInput getRendererInput();
+    // Main thread pumps window messages and file watchers, the render thread
+    // records and submits frames. Control commands are sent to the render thread
+    // in order, the latest input is in m_mousePos.
+    struct RenderCommand
+    {
+        enum class Type : uint32_t
+        {
+            resize          = 0,
+            updateImages    = 1,
+            updateShaders   = 2,
+            updateParams    = 3,
+            selectPreset    = 4,
+            stop            = 5,
+        };
+
+        Type type = Type::resize;
+        std::vector<std::string> files; // updateImages, updateShaders
+        uint32_t presetIndex = 0;       // selectPreset
+    };
+
+    void renderLoop();
+    void pushRenderCommand(RenderCommand&& command);
+    void stopRenderThread();
+
+    // glslang state for the compiles on any thread, destroyed after the job system
+    std::unique_ptr<ShaderCompilerProcess> m_shaderCompilerProcess;
+
+    // shared by all engine systems, destroyed after them
+    std::unique_ptr<JobSystem> m_jobSystem;
 
     std::unique_ptr<GfxResources> m_gfxResources;
 
@@ -41,9 +79,28 @@ private:
 
     std::unique_ptr<FileDirectoryWatcher> m_shaderDirWatcher;
     std::unique_ptr<FileDirectoryWatcher> m_imageDirWatcher;
+    std::unique_ptr<FileDirectoryWatcher> m_paramFileWatcher;
 
+    SpscQueue<RenderCommand, 256> m_renderQueue;
+    // written by the main thread every loop, read by the render thread every frame,
+    // a slow render thread only skips the inputs in between
+    std::atomic<MousePos> m_mousePos{ MousePos() };
+    std::thread m_renderThread;
+    std::exception_ptr m_renderException;
+    std::atomic<bool> m_renderThreadDone{ false };
+
+    // start of init, for the time to the first frame
+    std::chrono::steady_clock::time_point m_startTime;
+
+    // render thread data
     Timer m_timer;
     uint32_t m_frameIndex = 0;
+
+    // window title data from the render thread
+    std::atomic<bool> m_fpsUpdated{ false };
+    std::atomic<float> m_fps{ 0.0f };
+    std::atomic<float> m_timeSeconds{ 0.0f };
+    std::atomic<size_t> m_frameArenaHighWaterMark{ 0 };
 };
 
 } // namespace
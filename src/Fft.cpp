@@ -0,0 +1,126 @@
+// Copyright (c) 2017 Johannes Pystynen
+// This code is licensed under the MIT license (MIT)
+
+#include "Fft.h"
+
+#include <assert.h>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define DEF_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace core
+{
+
+Fft::Fft(const uint32_t size)
+    : m_size(size)
+{
+    assert(m_size >= 2 && (m_size & (m_size - 1)) == 0);
+
+    uint32_t bitCount = 0;
+    while ((1u << bitCount) < m_size)
+    {
+        ++bitCount;
+    }
+
+    m_bitReverse.resize(m_size);
+    for (uint32_t idx = 0; idx < m_size; ++idx)
+    {
+        uint32_t reversed = 0;
+        for (uint32_t bit = 0; bit < bitCount; ++bit)
+        {
+            reversed |= ((idx >> bit) & 1u) << (bitCount - 1u - bit);
+        }
+        m_bitReverse[idx] = reversed;
+    }
+
+    const double pi = 3.14159265358979323846;
+    m_twiddleRe.resize(m_size - 1);
+    m_twiddleIm.resize(m_size - 1);
+    for (uint32_t half = 1; half < m_size; half <<= 1)
+    {
+        for (uint32_t idx = 0; idx < half; ++idx)
+        {
+            const double angle = -pi * (double)idx / (double)half;
+            m_twiddleRe[half - 1 + idx] = (float)std::cos(angle);
+            m_twiddleIm[half - 1 + idx] = (float)std::sin(angle);
+        }
+    }
+}
+
+void Fft::forward(float* const p_re, float* const p_im) const
+{
+    assert(p_re && p_im);
+
+    for (uint32_t idx = 0; idx < m_size; ++idx)
+    {
+        const uint32_t reversed = m_bitReverse[idx];
+        if (idx < reversed)
+        {
+            std::swap(p_re[idx], p_re[reversed]);
+            std::swap(p_im[idx], p_im[reversed]);
+        }
+    }
+
+    for (uint32_t half = 1; half < m_size; half <<= 1)
+    {
+        const float* const p_twRe = &m_twiddleRe[half - 1];
+        const float* const p_twIm = &m_twiddleIm[half - 1];
+        for (uint32_t base = 0; base < m_size; base += 2 * half)
+        {
+            float* const p_re0 = p_re + base;
+            float* const p_im0 = p_im + base;
+            float* const p_re1 = p_re0 + half;
+            float* const p_im1 = p_im0 + half;
+
+            uint32_t idx = 0;
+#if (DEF_USE_SSE2 == 1)
+            // four butterflies at a time (stages with half >= 4)
+            for (; idx + 4 <= half; idx += 4)
+            {
+                const __m128 wr = _mm_loadu_ps(p_twRe + idx);
+                const __m128 wi = _mm_loadu_ps(p_twIm + idx);
+                const __m128 xr = _mm_loadu_ps(p_re1 + idx);
+                const __m128 xi = _mm_loadu_ps(p_im1 + idx);
+                const __m128 vr = _mm_sub_ps(_mm_mul_ps(xr, wr), _mm_mul_ps(xi, wi));
+                const __m128 vi = _mm_add_ps(_mm_mul_ps(xr, wi), _mm_mul_ps(xi, wr));
+                const __m128 ur = _mm_loadu_ps(p_re0 + idx);
+                const __m128 ui = _mm_loadu_ps(p_im0 + idx);
+                _mm_storeu_ps(p_re0 + idx, _mm_add_ps(ur, vr));
+                _mm_storeu_ps(p_im0 + idx, _mm_add_ps(ui, vi));
+                _mm_storeu_ps(p_re1 + idx, _mm_sub_ps(ur, vr));
+                _mm_storeu_ps(p_im1 + idx, _mm_sub_ps(ui, vi));
+            }
+#endif
+            for (; idx < half; ++idx)
+            {
+                const float wr = p_twRe[idx];
+                const float wi = p_twIm[idx];
+                const float vr = p_re1[idx] * wr - p_im1[idx] * wi;
+                const float vi = p_re1[idx] * wi + p_im1[idx] * wr;
+                const float ur = p_re0[idx];
+                const float ui = p_im0[idx];
+                p_re0[idx] = ur + vr;
+                p_im0[idx] = ui + vi;
+                p_re1[idx] = ur - vr;
+                p_im1[idx] = ui - vi;
+            }
+        }
+    }
+}
+
+uint32_t Fft::getSize() const
+{
+    return m_size;
+}
+
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////
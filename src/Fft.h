@@ -0,0 +1,45 @@
+#ifndef CORE_FFT_H
+#define CORE_FFT_H
+
+// Copyright (c) 2017 Johannes Pystynen
+// This code is licensed under the MIT license (MIT)
+
+#include <cstdint>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace core
+{
+
+// Radix-2 complex fft for split (separate real and imaginary) data.
+// Butterflies are vectorized with SSE2 when available.
+class Fft
+{
+public:
+    explicit Fft(const uint32_t size); // power of two
+    ~Fft() = default;
+
+    Fft(const Fft&) = delete;
+    Fft& operator=(const Fft&) = delete;
+
+    // In-place forward transform, both arrays have getSize() elements.
+    void forward(float* const p_re, float* const p_im) const;
+
+    uint32_t getSize() const;
+
+private:
+    uint32_t m_size = 0;
+
+    std::vector<uint32_t> m_bitReverse;
+
+    // twiddles for the butterfly stage of half size h start at index h - 1
+    std::vector<float> m_twiddleRe;
+    std::vector<float> m_twiddleIm;
+};
+
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif // CORE_FFT_H
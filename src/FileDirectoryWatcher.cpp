@@ -3,211 +3,342 @@
 
 #include "FileDirectoryWatcher.h"
 
-#include <assert.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <mutex>
 #include <string>
 #include <vector>
-#include <iostream>
-#include <future>
-
-#include <windows.h>
 
 ///////////////////////////////////////////////////////////////////////////////
 
-namespace core
+namespace
 {
 
-FileDirectoryWatcher::FileDirectoryWatcher(
-    const std::string& directory,
-    const std::vector<std::string>& filenames,
-    const bool dropExtension)
-    : m_directory(directory),
-    m_cropExtension(dropExtension)
+// Glob match, '*' and '?' do not match '/', "**/" matches zero or more directories.
+bool matchGlob(const char* p_pattern, const char* p_path)
 {
-    setupTimestamps(filenames);
+    while (*p_pattern)
+    {
+        if (p_pattern[0] == '*' && p_pattern[1] == '*' && p_pattern[2] == '/')
+        {
+            p_pattern += 3;
+            for (;;)
+            {
+                if (matchGlob(p_pattern, p_path))
+                {
+                    return true;
+                }
+                p_path = std::strchr(p_path, '/');
+                if (!p_path)
+                {
+                    return false;
+                }
+                ++p_path;
+            }
+        }
+        if (*p_pattern == '*')
+        {
+            ++p_pattern;
+            for (;;)
+            {
+                if (matchGlob(p_pattern, p_path))
+                {
+                    return true;
+                }
+                if (*p_path == '\0' || *p_path == '/')
+                {
+                    return false;
+                }
+                ++p_path;
+            }
+        }
+        if (*p_path == '\0')
+        {
+            return false;
+        }
+        if ((*p_pattern == '?') ? (*p_path == '/') : (*p_pattern != *p_path))
+        {
+            return false;
+        }
+        ++p_pattern;
+        ++p_path;
+    }
+    return *p_path == '\0';
+}
 
-    m_stopEventHandle = CreateEvent(
-        NULL,   // lpEventAttributes
-        true,   // bManualReset
-        false,  // bInitialState
-        NULL);  // lpName
-    assert(m_stopEventHandle != NULL && m_stopEventHandle != INVALID_HANDLE_VALUE);
+} // namespace
 
-    startWatch();
+namespace core
+{
+
+// 64-bit FNV-1a of the file content, false if the file can not be read.
+bool getFileHash(const std::string& filename, uint64_t& hash)
+{
+    uint64_t byteSize = 0;
+    return getFileHash(filename, hash, byteSize);
 }
 
-FileDirectoryWatcher::~FileDirectoryWatcher()
+bool getFileHash(const std::string& filename, uint64_t& hash, uint64_t& byteSize)
 {
-    // send stop event
-    SetEvent(m_stopEventHandle);
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
 
-    bool destroyHandle = false;
-    if (m_watcher.valid())
+    hash = 14695981039346656037ull;
+    byteSize = 0;
+    char buffer[64 * 1024];
+    while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0)
     {
-        // wait if async still running
-        if (m_watcher.wait_for(std::chrono::seconds(5)) == std::future_status::ready)
+        const std::streamsize readCount = file.gcount();
+        for (std::streamsize idx = 0; idx < readCount; ++idx)
         {
-            m_watcher.get();
-            destroyHandle = true;
+            hash = (hash ^ (uint8_t)buffer[idx]) * 1099511628211ull;
         }
-        assert((!m_watcher.valid()) && "Async thread not stopped. Stop event did not work!");
-    }
-    
-    if (m_stopEventHandle != NULL && m_stopEventHandle != INVALID_HANDLE_VALUE && destroyHandle)
-    {
-        CloseHandle(m_stopEventHandle);
+        byteSize += (uint64_t)readCount;
     }
+    return true;
 }
 
-void FileDirectoryWatcher::startWatch()
+bool FileDirectoryWatcher::checkForChanges()
 {
-    auto watchFunc = [](const std::string& directory, HANDLE stopHandle)
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_changeDetected = !m_changedFiles.empty() && (now - m_lastEventTime >= c_debounceTime);
+    return m_changeDetected;
+}
+
+std::vector<std::string> FileDirectoryWatcher::getChangedFilesAndReset()
+{
+    std::vector<std::string> changedFiles;
+    if (m_changeDetected)
     {
-        bool retValue = false; // change notification -> true
-        const LPTSTR dir = (char*)directory.c_str();
-        constexpr DWORD notifyFilter = FILE_NOTIFY_CHANGE_LAST_WRITE
-            | FILE_NOTIFY_CHANGE_CREATION
-            | FILE_NOTIFY_CHANGE_FILE_NAME;
-        HANDLE changeHandle = FindFirstChangeNotification(
-            dir,            // lpPathName
-            false,          // bWatchSubtree
-            notifyFilter);  // dwNotifyFilter
-
-        std::vector<HANDLE> watchHandles {changeHandle, stopHandle};
-
-        if (changeHandle != INVALID_HANDLE_VALUE && changeHandle != NULL)
+        m_changeDetected = false;
         {
-            DWORD waitStatus = WaitForMultipleObjects(
-                (DWORD)watchHandles.size(), // nCount
-                watchHandles.data(),        // lpHandles
-                false,                      // bWaitAll
-                (DWORD)INFINITE);           // dwMilliseconds
-
-            switch (waitStatus)
-            {
-            case WAIT_OBJECT_0:     // change notification
-                retValue = true;
-                break;
-            case WAIT_OBJECT_0 + 1: // stop event
-                retValue = false;
-                break;
-            case WAIT_FAILED:
-                retValue = false;
-                std::cout << "FileDirectoryWatcher WAIT_FAILED: " << GetLastError();
-                break;
-            default : break;
-            }
-
-            CloseHandle(changeHandle);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            changedFiles.swap(m_changedFiles);
         }
+        changedFiles = getContentChangedFiles(changedFiles);
+    }
+    return changedFiles;
+}
 
-        return retValue;
-    };
-
-    ResetEvent(m_stopEventHandle);
-    m_watcher = std::async(std::launch::async, watchFunc, m_directory, m_stopEventHandle);
+void FileDirectoryWatcher::addChangedFile(const std::string& path)
+{
+    m_lastEventTime = std::chrono::steady_clock::now();
+    if (isWatched(path)
+        && std::find(m_changedFiles.begin(), m_changedFiles.end(), path) == m_changedFiles.end())
+    {
+        m_changedFiles.emplace_back(path);
+    }
 }
 
-bool FileDirectoryWatcher::checkForChanges()
+bool FileDirectoryWatcher::isWatched(const std::string& path)
 {
-    if (m_watcher.valid())
+    auto iter = m_watchedCache.find(path);
+    if (iter != m_watchedCache.end())
+    {
+        return iter->second;
+    }
+
+    bool watched = false;
+    for (const auto& patternRef : m_patterns)
     {
-        if (m_watcher.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+        if (matchGlob(patternRef.c_str(), path.c_str()))
         {
-            m_changeDetected = m_watcher.get();
+            watched = true;
+            break;
         }
     }
-    return m_changeDetected;
+    if (m_watchedCache.size() >= c_maxWatchedCacheSize)
+    {
+        m_watchedCache.clear();
+    }
+    m_watchedCache.emplace(path, watched);
+    return watched;
 }
 
-std::vector<std::string> FileDirectoryWatcher::getChangedFilesAndReset()
+std::vector<std::string> FileDirectoryWatcher::getContentChangedFiles(
+    const std::vector<std::string>& filenames)
 {
     std::vector<std::string> changedFiles;
-    if (m_changeDetected)
+    for (const auto& filenameRef : filenames)
     {
-        m_changeDetected = false;
-        changedFiles = getWriteStampFiles();
-        if (!m_watcher.valid())
+        uint64_t hash = 0;
+        if (!getFileHash(m_directory + "/" + filenameRef, hash))
         {
-            startWatch();
+            // removed or unreadable, let the reload handle it;
+            // the file is reported again when it comes back
+            m_contentHashes.erase(filenameRef);
+            changedFiles.emplace_back(filenameRef);
+            continue;
+        }
+        auto iter = m_contentHashes.find(filenameRef);
+        if (iter == m_contentHashes.end() || iter->second != hash)
+        {
+            m_contentHashes[filenameRef] = hash;
+            changedFiles.emplace_back(filenameRef);
         }
     }
     return changedFiles;
 }
 
-std::vector<std::string> FileDirectoryWatcher::getWriteStampFiles()
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////
+
+#ifdef _WIN32
+
+#include <assert.h>
+#include <iostream>
+
+#include <windows.h>
+
+namespace core
 {
-    std::vector<std::string> writeStampFiles;
-
-    WIN32_FIND_DATA findData{};
-    const std::string dir = m_directory + std::string("/*");
-    HANDLE hFile = FindFirstFile(
-        dir.c_str(),
-        &findData);
-    if (hFile != INVALID_HANDLE_VALUE)
+
+FileDirectoryWatcher::FileDirectoryWatcher(
+    const std::string& directory,
+    const std::vector<std::string>& patterns)
+    : m_directory(directory),
+    m_patterns(patterns)
+{
+    m_directoryHandle = CreateFile(
+        m_directory.c_str(),                                    // lpFileName
+        FILE_LIST_DIRECTORY,                                    // dwDesiredAccess
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, // dwShareMode
+        NULL,                                                   // lpSecurityAttributes
+        OPEN_EXISTING,                                          // dwCreationDisposition
+        FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,      // dwFlagsAndAttributes
+        NULL);                                                  // hTemplateFile
+    if (m_directoryHandle == INVALID_HANDLE_VALUE)
     {
-        while (FindNextFile(hFile, &findData) != 0)
-        {
-            std::string filename = findData.cFileName;
-            std::string compareFilename = filename;
-            if (m_cropExtension)
-            {
-                compareFilename = std::move(getCroppedName(compareFilename));
-            }
-            auto iter = m_watchedFiles.find(compareFilename);
-            if (iter != m_watchedFiles.end())
-            {
-                const uint64_t currTimestamp = ((uint64_t)findData.ftLastWriteTime.dwHighDateTime << 32u)
-                    | ((uint64_t)findData.ftLastWriteTime.dwLowDateTime);
-                if (currTimestamp != iter->second)
-                {
-                    iter->second = currTimestamp;
-                    writeStampFiles.emplace_back(filename);
-                }
-            }
-        }
+        std::cerr << "FileDirectoryWatcher can not watch " << m_directory << ": " << GetLastError() << std::endl;
+        return;
+    }
+
+    m_stopEventHandle = CreateEvent(
+        NULL,   // lpEventAttributes
+        true,   // bManualReset
+        false,  // bInitialState
+        NULL);  // lpName
+    assert(m_stopEventHandle != NULL && m_stopEventHandle != INVALID_HANDLE_VALUE);
+
+    m_watcher = std::thread(&FileDirectoryWatcher::watchLoop, this);
+}
+
+FileDirectoryWatcher::~FileDirectoryWatcher()
+{
+    if (m_watcher.joinable())
+    {
+        // wakes up the wait, the watch thread exits right away
+        SetEvent(m_stopEventHandle);
+        m_watcher.join();
     }
 
-    return writeStampFiles;
+    if (m_stopEventHandle != NULL && m_stopEventHandle != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_stopEventHandle);
+    }
+    if (m_directoryHandle != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_directoryHandle);
+    }
 }
 
-void FileDirectoryWatcher::setupTimestamps(const std::vector<std::string>& filenames)
+void FileDirectoryWatcher::watchLoop()
 {
-    WIN32_FIND_DATA findData{};
-    const std::string dir = m_directory + std::string("/*");
-    HANDLE hFile = FindFirstFile(
-        dir.c_str(),
-        &findData);
-    if (hFile != INVALID_HANDLE_VALUE)
+    OVERLAPPED overlapped{};
+    overlapped.hEvent = CreateEvent(NULL, true, false, NULL);
+    assert(overlapped.hEvent != NULL);
+
+    const std::vector<HANDLE> watchHandles{ overlapped.hEvent, m_stopEventHandle };
+
+    // FILE_NOTIFY_INFORMATION entries are DWORD aligned
+    std::vector<DWORD> buffer(16 * 1024);
+
+    constexpr DWORD notifyFilter = FILE_NOTIFY_CHANGE_LAST_WRITE
+        | FILE_NOTIFY_CHANGE_CREATION
+        | FILE_NOTIFY_CHANGE_FILE_NAME;
+
+    for (;;)
     {
-        while (FindNextFile(hFile, &findData) != 0)
+        ResetEvent(overlapped.hEvent);
+        const BOOL started = ReadDirectoryChangesW(
+            m_directoryHandle,                      // hDirectory
+            buffer.data(),                          // lpBuffer
+            (DWORD)(buffer.size() * sizeof(DWORD)), // nBufferLength
+            true,                                   // bWatchSubtree
+            notifyFilter,                           // dwNotifyFilter
+            NULL,                                   // lpBytesReturned
+            &overlapped,                            // lpOverlapped
+            NULL);                                  // lpCompletionRoutine
+        if (!started)
         {
-            const std::string dirFilename = m_cropExtension ?
-                std::move(getCroppedName(findData.cFileName)) :
-                findData.cFileName;
+            std::cerr << "FileDirectoryWatcher ReadDirectoryChangesW failed: " << GetLastError() << std::endl;
+            break;
+        }
 
-            for (const auto& filenameRef : filenames)
+        const DWORD waitStatus = WaitForMultipleObjects(
+            (DWORD)watchHandles.size(), // nCount
+            watchHandles.data(),        // lpHandles
+            false,                      // bWaitAll
+            (DWORD)INFINITE);           // dwMilliseconds
+        if (waitStatus != WAIT_OBJECT_0)
+        {
+            // stop event or failure
+            CancelIo(m_directoryHandle);
+            DWORD ignored = 0;
+            GetOverlappedResult(m_directoryHandle, &overlapped, &ignored, true);
+            break;
+        }
+
+        DWORD byteCount = 0;
+        if (!GetOverlappedResult(m_directoryHandle, &overlapped, &byteCount, false) || byteCount == 0)
+        {
+            // buffer overflow, the changes of this burst are lost
+            std::cerr << "FileDirectoryWatcher missed changes in " << m_directory << std::endl;
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const uint8_t* p_entry = (const uint8_t*)buffer.data();
+        for (;;)
+        {
+            const FILE_NOTIFY_INFORMATION* p_info = (const FILE_NOTIFY_INFORMATION*)p_entry;
+            // removed files are reported too, the reload drops their content
+            if (p_info->Action == FILE_ACTION_ADDED
+                || p_info->Action == FILE_ACTION_MODIFIED
+                || p_info->Action == FILE_ACTION_RENAMED_NEW_NAME
+                || p_info->Action == FILE_ACTION_REMOVED
+                || p_info->Action == FILE_ACTION_RENAMED_OLD_NAME)
             {
-                if (filenameRef == dirFilename)
-                {
-                    const uint64_t timestamp = ((uint64_t)findData.ftLastWriteTime.dwHighDateTime << 32u)
-                        | ((uint64_t)findData.ftLastWriteTime.dwLowDateTime);
-                    m_watchedFiles.emplace(dirFilename, timestamp);
-                }
+                const int wideLength = (int)(p_info->FileNameLength / sizeof(WCHAR));
+                const int length = WideCharToMultiByte(CP_UTF8, 0,
+                    p_info->FileName, wideLength, NULL, 0, NULL, NULL);
+                std::string path(length, '\0');
+                WideCharToMultiByte(CP_UTF8, 0,
+                    p_info->FileName, wideLength, &path[0], length, NULL, NULL);
+                std::replace(path.begin(), path.end(), '\\', '/');
+                addChangedFile(path);
             }
+            if (p_info->NextEntryOffset == 0)
+            {
+                break;
+            }
+            p_entry += p_info->NextEntryOffset;
         }
     }
-}
 
-std::string FileDirectoryWatcher::getCroppedName(const std::string& fullname)
-{
-    const size_t lastIndex = fullname.find_last_of(".");
-    if (lastIndex != std::string::npos)
-    {
-        return fullname.substr(0, lastIndex);
-    }
-    return fullname;
+    CloseHandle(overlapped.hEvent);
 }
 
 } // namespace
 
+#endif // _WIN32
+
 ///////////////////////////////////////////////////////////////////////////////
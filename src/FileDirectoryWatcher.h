@@ -4,50 +4,98 @@
 // Copyright (c) 2017 Johannes Pystynen
 // This code is licensed under the MIT license (MIT)
 
-#include <future>
+#include <chrono>
 #include <cstdint>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
+#ifdef _WIN32
 #include <windows.h>
+#endif
 
 ///////////////////////////////////////////////////////////////////////////////
 
 namespace core
 {
 
+// 64-bit FNV-1a of the file content, false if the file can not be read.
+bool getFileHash(const std::string& filename, uint64_t& hash);
+// Also returns the file size in bytes.
+bool getFileHash(const std::string& filename, uint64_t& hash, uint64_t& byteSize);
+
+// Watches a directory tree for changes to the files matching the glob patterns.
+// Patterns are relative to the directory with '/' separators:
+// '*' and '?' do not cross directories, "**/" matches any number of directories.
+// E.g. "channel0.*", "*.frag", "**/*.glsl".
+// Win32 backend uses ReadDirectoryChangesW and Linux backend inotify, both
+// report the changed files directly so the tree is never rescanned.
+// Bursts of events (editors save in several writes) are reported once
+// and files with unchanged content are dropped. Removed files are reported
+// as changed, the reload finds them missing.
 class FileDirectoryWatcher
 {
 public:
     FileDirectoryWatcher(const std::string& directory,
-        const std::vector<std::string>& filenames,
-        const bool dropExtension);
+        const std::vector<std::string>& patterns);
     ~FileDirectoryWatcher();
 
     FileDirectoryWatcher(const FileDirectoryWatcher&) = delete;
     FileDirectoryWatcher& operator=(const FileDirectoryWatcher&) = delete;
 
+    // True when there are changes and no new events for c_debounceTime.
     bool checkForChanges();
 
-    // Returns the filenames of the files that have changed
+    // Returns the files that have changed (relative to the directory)
     // and starts the watch again.
-    // Returns full filenames (non cropped).
+    // Files with the same content as when last reported are skipped.
     std::vector<std::string> getChangedFilesAndReset();
 private:
-    void startWatch();
+    void watchLoop();
+
+    // Called by the watch thread with m_mutex locked.
+    void addChangedFile(const std::string& path);
+    bool isWatched(const std::string& path);
+
+    std::vector<std::string> getContentChangedFiles(const std::vector<std::string>& filenames);
 
-    std::vector<std::string> getWriteStampFiles();
-    void setupTimestamps(const std::vector<std::string>& filenames);
-    std::string getCroppedName(const std::string& fullname);
+    const std::chrono::milliseconds c_debounceTime{ 100 };
+    const size_t c_maxWatchedCacheSize = 4096;
 
     std::string m_directory;
-    std::unordered_map<std::string, uint64_t> m_watchedFiles;
+    const std::vector<std::string> m_patterns;
     bool m_changeDetected = false;
 
-    std::future<bool> m_watcher;
-    HANDLE m_stopEventHandle;
-    // crop extension from input files and directory files when comparing
-    bool m_cropExtension = false;
+    // pattern match result of the seen paths, patterns are matched once per path
+    // (cleared when full, e.g. a build writing many temporary files in the tree)
+    std::unordered_map<std::string, bool> m_watchedCache;
+
+    // changed files since the last getChangedFilesAndReset, in event order
+    // (m_changedFiles, m_lastEventTime and m_watchedCache are shared with the watch thread)
+    std::vector<std::string> m_changedFiles;
+    std::chrono::steady_clock::time_point m_lastEventTime;
+    std::mutex m_mutex;
+
+    // content hash of the reported files, a file is reported on its first change
+    std::unordered_map<std::string, uint64_t> m_contentHashes;
+
+    std::thread m_watcher;
+
+#ifdef _WIN32
+    HANDLE m_directoryHandle    = INVALID_HANDLE_VALUE;
+    HANDLE m_stopEventHandle    = NULL;
+#else
+    void addWatchRecursive(const std::string& relativeDirectory);
+
+    // watch descriptor -> directory relative to m_directory ("" for the root)
+    std::unordered_map<int, std::string> m_watchDirectories;
+
+    int m_inotifyFd = -1;
+    int m_epollFd   = -1;
+    int m_stopFd    = -1; // eventfd, written by the destructor
+#endif
 };
 
 } // namespace
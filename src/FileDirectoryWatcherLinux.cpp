@@ -0,0 +1,204 @@
+// Copyright (c) 2017 Johannes Pystynen
+// This code is licensed under the MIT license (MIT)
+
+#include "FileDirectoryWatcher.h"
+
+#ifndef _WIN32
+
+#include <algorithm>
+#include <assert.h>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+
+// editors either write the file in place or move a temporary file over it,
+// new directories are watched when created or moved in, removed files are reported too
+constexpr uint32_t c_watchMask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE | IN_MOVED_FROM;
+
+} // namespace
+
+namespace core
+{
+
+FileDirectoryWatcher::FileDirectoryWatcher(
+    const std::string& directory,
+    const std::vector<std::string>& patterns)
+    : m_directory(directory),
+    m_patterns(patterns)
+{
+    m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    m_stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_inotifyFd < 0 || m_stopFd < 0 || m_epollFd < 0)
+    {
+        std::cerr << "FileDirectoryWatcher init failed: " << std::strerror(errno) << std::endl;
+        return;
+    }
+
+    // inotify is not recursive, every directory of the tree has its own watch
+    addWatchRecursive("");
+    if (m_watchDirectories.empty())
+    {
+        return;
+    }
+
+    for (const int fd : { m_inotifyFd, m_stopFd })
+    {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) < 0)
+        {
+            std::cerr << "FileDirectoryWatcher epoll_ctl failed: " << std::strerror(errno) << std::endl;
+            return;
+        }
+    }
+
+    m_watcher = std::thread(&FileDirectoryWatcher::watchLoop, this);
+}
+
+FileDirectoryWatcher::~FileDirectoryWatcher()
+{
+    if (m_watcher.joinable())
+    {
+        // wakes up epoll_wait, the watch thread exits right away
+        const uint64_t stop = 1;
+        const ssize_t written = write(m_stopFd, &stop, sizeof(stop));
+        assert(written == sizeof(stop));
+        (void)written;
+        m_watcher.join();
+    }
+
+    for (const int fd : { m_epollFd, m_stopFd, m_inotifyFd })
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+}
+
+void FileDirectoryWatcher::addWatchRecursive(const std::string& relativeDirectory)
+{
+    const std::string path = relativeDirectory.empty() ?
+        m_directory : m_directory + "/" + relativeDirectory;
+    const int watchDescriptor = inotify_add_watch(m_inotifyFd, path.c_str(), c_watchMask);
+    if (watchDescriptor < 0)
+    {
+        std::cerr << "FileDirectoryWatcher can not watch " << path << ": "
+            << std::strerror(errno) << std::endl;
+        return;
+    }
+    m_watchDirectories[watchDescriptor] = relativeDirectory;
+
+    DIR* p_dir = opendir(path.c_str());
+    if (!p_dir)
+    {
+        return;
+    }
+    while (const dirent* p_entry = readdir(p_dir))
+    {
+        const std::string name = p_entry->d_name;
+        if (name == "." || name == ".." || p_entry->d_type != DT_DIR)
+        {
+            continue;
+        }
+        addWatchRecursive(relativeDirectory.empty() ? name : relativeDirectory + "/" + name);
+    }
+    closedir(p_dir);
+}
+
+void FileDirectoryWatcher::watchLoop()
+{
+    // large enough for several events with maximum name length
+    alignas(inotify_event) char buffer[16 * (sizeof(inotify_event) + NAME_MAX + 1)];
+
+    for (;;)
+    {
+        epoll_event events[2];
+        const int eventCount = epoll_wait(m_epollFd, events, 2, -1);
+        if (eventCount < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            std::cerr << "FileDirectoryWatcher epoll_wait failed: " << std::strerror(errno) << std::endl;
+            return;
+        }
+
+        for (int eventIdx = 0; eventIdx < eventCount; ++eventIdx)
+        {
+            if (events[eventIdx].data.fd == m_stopFd)
+            {
+                return;
+            }
+        }
+
+        // drain all pending inotify events
+        for (;;)
+        {
+            const ssize_t readSize = read(m_inotifyFd, buffer, sizeof(buffer));
+            if (readSize <= 0)
+            {
+                break;
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (ssize_t offset = 0; offset < readSize;)
+            {
+                const inotify_event* p_event = (const inotify_event*)(buffer + offset);
+                offset += sizeof(inotify_event) + p_event->len;
+
+                if (p_event->mask & IN_IGNORED)
+                {
+                    // directory removed
+                    m_watchDirectories.erase(p_event->wd);
+                    continue;
+                }
+                auto dirIter = m_watchDirectories.find(p_event->wd);
+                if (p_event->len == 0 || dirIter == m_watchDirectories.end())
+                {
+                    continue;
+                }
+
+                const std::string path = dirIter->second.empty() ?
+                    std::string(p_event->name) : dirIter->second + "/" + p_event->name;
+                if (p_event->mask & IN_ISDIR)
+                {
+                    if (p_event->mask & (IN_CREATE | IN_MOVED_TO))
+                    {
+                        addWatchRecursive(path);
+                    }
+                }
+                else if (p_event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM))
+                {
+                    addChangedFile(path);
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
+#endif // _WIN32
+
+///////////////////////////////////////////////////////////////////////////////
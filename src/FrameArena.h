@@ -0,0 +1,84 @@
+#ifndef CORE_FRAME_ARENA_H
+#define CORE_FRAME_ARENA_H
+
+// Copyright (c) 2017 Johannes Pystynen
+// This code is licensed under the MIT license (MIT)
+
+#include <algorithm>
+#include <assert.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace core
+{
+
+// Linear allocator for transient data of one frame (barrier arrays etc.).
+// The memory is allocated once, allocating only moves an offset and
+// reset() at the start of the next frame frees everything.
+// Destructors are never run, so only trivially destructible types are allowed.
+class FrameArena
+{
+public:
+    explicit FrameArena(const size_t byteSize)
+        : m_memory(new uint8_t[byteSize]),
+        m_byteSize(byteSize)
+    { }
+    ~FrameArena() = default;
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // Returns count value initialized elements, nullptr if the arena is full.
+    template <typename T>
+    T* allocate(const size_t count)
+    {
+        static_assert(std::is_trivially_destructible<T>::value,
+            "FrameArena does not run destructors");
+        static_assert(alignof(T) <= alignof(std::max_align_t),
+            "FrameArena memory is aligned for fundamental types only");
+
+        const size_t offset = (m_offset + alignof(T) - 1) & ~(alignof(T) - 1);
+        if (count > (m_byteSize - std::min(offset, m_byteSize)) / sizeof(T))
+        {
+            assert(false && "Frame arena is full, increase its size");
+            return nullptr;
+        }
+        m_offset = offset + count * sizeof(T);
+        m_highWaterMark = std::max(m_highWaterMark, m_offset);
+
+        T* const p_data = reinterpret_cast<T*>(m_memory.get() + offset);
+        for (size_t idx = 0; idx < count; ++idx)
+        {
+            new (p_data + idx) T();
+        }
+        return p_data;
+    }
+
+    void reset()
+    {
+        m_offset = 0;
+    }
+
+    // Largest number of bytes used in a frame, for sizing the arena.
+    size_t getHighWaterMark() const
+    {
+        return m_highWaterMark;
+    }
+
+private:
+    std::unique_ptr<uint8_t[]> m_memory;
+    const size_t m_byteSize = 0;
+    size_t m_offset         = 0;
+    size_t m_highWaterMark  = 0;
+};
+
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif // CORE_FRAME_ARENA_H
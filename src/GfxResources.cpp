@@ -296,8 +296,12 @@ void GfxResources::createPhysicalDevice()
     }
     assert(m_queue.queueFamilyIndex != ~0u);
 
-    // we don't need anything fancy
+    // we don't need anything fancy, the texture array can be indexed with uniforms
+    // and channels can use anisotropic filtering if supported
     VkPhysicalDeviceFeatures requiredDeviceFeatures = {};
+    requiredDeviceFeatures.shaderSampledImageArrayDynamicIndexing =
+        m_device.physicalDeviceFeatures.shaderSampledImageArrayDynamicIndexing;
+    requiredDeviceFeatures.samplerAnisotropy = m_device.physicalDeviceFeatures.samplerAnisotropy;
 
     constexpr float queuePriorities[] = { 0.0f };
     const VkDeviceQueueCreateInfo deviceQueueCreateInfo =
@@ -424,6 +428,8 @@ void GfxResources::createSwapchain()
         assert(surfaceSupported == VK_TRUE);
     }
 
+    m_swapchain.extent = { mp_window->getWidth(), mp_window->getHeight() };
+
     const VkSwapchainCreateInfoKHR swapchainCreateInfo =
     {
         VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,            // sType
@@ -433,7 +439,7 @@ void GfxResources::createSwapchain()
         c_bufferingCount,                                       // minImageCount
         m_swapchain.imageFormat,                                // imageFormat
         m_swapchain.colorSpace,                                 // imageColorSpace
-        VkExtent2D{ mp_window->getWidth(), mp_window->getHeight() },  // imageExtent
+        m_swapchain.extent,                                     // imageExtent
         1,                                                      // imageArrayLayers
         VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,                    // imageUsage
         VK_SHARING_MODE_EXCLUSIVE,                              // imageSharingMode
@@ -524,8 +530,9 @@ void GfxResources::createDescriptorPools()
     {
         const VkDescriptorPoolSize descriptorPoolSize =
         {
-            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,  // type
-            m_descriptorPool.c_bindingCountUniform      // descriptorCount
+            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,          // type
+            m_descriptorPool.c_bindingCountUniform
+                * m_descriptorPool.c_maxSetsUniform     // descriptorCount
         };
 
         // create with free-flag for convinience with image descriptor updates
@@ -552,7 +559,8 @@ void GfxResources::createDescriptorPools()
         const VkDescriptorPoolSize descriptorPoolSize =
         {
             VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,  // type
-            m_descriptorPool.c_bindingCountImage        // descriptorCount
+            (m_descriptorPool.c_bindingCountImage + m_descriptorPool.c_maxTextureArraySize)
+                * m_descriptorPool.c_maxSetsImage       // descriptorCount
         };
 
         // create with free-flag for convenience with image descriptor updates
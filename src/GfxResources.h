@@ -83,6 +83,10 @@ public:
 
     VkFormat imageFormat        = VK_FORMAT_UNDEFINED;
     VkColorSpaceKHR colorSpace  = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+
+    // window size when the swapchain was created, render targets use this
+    // (the window might be resized again before the swapchain is recreated)
+    VkExtent2D extent           = { 0, 0 };
 };
 
 class GfxQueue
@@ -100,6 +104,7 @@ public:
         VkCommandBuffer commandBuffer   = nullptr;
         VkFence fence                   = nullptr;
         VkSemaphore submitSemaphore     = nullptr;
+        uint32_t bufferIndex            = 0;
     };
 
     CmdBuffer getNextCmdBuffer()
@@ -107,6 +112,7 @@ public:
         m_bufferIndex = (m_bufferIndex + 1) % commandBuffers.size();
 
         CmdBuffer cmdbuf;
+        cmdbuf.bufferIndex = m_bufferIndex;
         cmdbuf.commandBuffer = commandBuffers[m_bufferIndex];
         cmdbuf.fence = commandBufferFences[m_bufferIndex];
         cmdbuf.submitSemaphore = cmdBufferSubmitSemaphore;
@@ -126,12 +132,13 @@ private:
 class GfxDescriptorPool
 {
 public:
-    const uint32_t c_maxSetsUniform         = 1;
-    const uint32_t c_bindingCountUniform    = 1;
+    const uint32_t c_maxSetsUniform         = 3; // one per command buffer
+    const uint32_t c_bindingCountUniform    = 3; // channel uniforms, user parameters and frame inputs
     VkDescriptorPool uniforms               = nullptr;
 
-    const uint32_t c_maxSetsImage       = 1;
-    const uint32_t c_bindingCountImage  = 4;
+    const uint32_t c_maxSetsImage       = 3; // one per command buffer
+    const uint32_t c_bindingCountImage  = 4; // channels, the texture array is the next binding
+    const uint32_t c_maxTextureArraySize = 64;
     VkDescriptorPool images             = nullptr;
 };
 
@@ -17,14 +17,16 @@
 namespace core
 {
 
-// Triple buffered dynamic uniform buffer.
+// Uniform buffer with bufferCount slots (e.g. triple buffered for dynamic offsets).
 class GpuBufferUniform
 {
 public:
     GpuBufferUniform(GfxDevice* const p_gfxDevice,
-        const uint32_t sizeInBytes) // bytesize of a single buffer (even when triple buffered)
+        const uint32_t sizeInBytes, // bytesize of a single buffer (even when triple buffered)
+        const uint32_t bufferCount = 3)
         : mp_device(p_gfxDevice),
-        byteSize(sizeInBytes)
+        byteSize(sizeInBytes),
+        c_bufferCount(bufferCount)
     {
         assert(mp_device);
         assert(mp_device->logicalDevice);
@@ -121,21 +123,20 @@ public:
     GpuBufferUniform(const GpuBufferUniform&) = delete;
     GpuBufferUniform& operator=(const GpuBufferUniform&) = delete;
 
-    void copyData(const uint32_t sizeInBytes, const uint8_t* const p_data)
+    // bufferIndex: buffer not in use by the gpu, e.g. the command buffer index
+    void copyData(const uint32_t bufferIndex, const uint32_t sizeInBytes, const uint8_t* const p_data)
     {
+        assert(bufferIndex < c_bufferCount);
         assert(sizeInBytes <= byteSize);
 
-        // next buffer
-        m_bufferIndex = (m_bufferIndex + 1) % c_bufferCount;
-
         const uint32_t minByteSize = std::min((uint32_t)byteSize, sizeInBytes);
-        uint8_t* const offset = (uint8_t*)(mp_data) + m_bufferIndex * byteSize;
+        uint8_t* const offset = (uint8_t*)(mp_data) + getByteOffset(bufferIndex);
         std::memcpy(offset, p_data, minByteSize);
     }
 
-    uint32_t getByteOffset()
+    uint32_t getByteOffset(const uint32_t bufferIndex) const
     {
-        return m_bufferIndex * byteSize;
+        return bufferIndex * byteSize;
     }
 
     // variables (public for easier access)
@@ -153,25 +154,23 @@ private:
     VkDeviceMemory m_deviceMemory   = nullptr;
 
     void* mp_data           = nullptr;  // data pointer for copying data to buffer
-    uint32_t m_bufferIndex  = 0;        // for triple buffer
 };
 
 ///////////////////////////////////////////////////////////////////////////////
 
 // Staging buffer for copying data to e.g. gpu images.
+// Data is written directly to the mapped memory (map() / unmap()).
 class GpuBufferStaging
 {
 public:
     GpuBufferStaging(GfxDevice* const p_device,
-        const uint32_t sizeInBytes,
-        const uint8_t* const p_inputData)
+        const uint32_t sizeInBytes)
         : mp_gfxDevice(p_device),
         byteSize(sizeInBytes)
     {
         assert(mp_gfxDevice);
         assert(mp_gfxDevice->logicalDevice);
         assert(byteSize > 0);
-        assert(p_inputData);
 
         const uint32_t minByteAlignment = (uint32_t)
             mp_gfxDevice->physicalDeviceProperties.limits.minMemoryMapAlignment;
@@ -230,29 +229,16 @@ public:
             buffer,                     // buffer
             m_deviceMemory,             // memory
             0));                        // memoryOffset
-
-        // copy data to gpu
-
-        void* p_memOffset = nullptr;
-        CHECK_VK_RESULT_SUCCESS(vkMapMemory(
-            mp_gfxDevice->logicalDevice,// device
-            m_deviceMemory,             // memory
-            0,                          // offset
-            (VkDeviceSize)byteSize,     // size
-            0,                          // flags
-            &p_memOffset));             // ppData
-
-        std::memcpy((uint8_t*)p_memOffset, p_inputData, byteSize);
-
-        vkUnmapMemory(
-            mp_gfxDevice->logicalDevice,    // device
-            m_deviceMemory);                // memory
     }
 
     ~GpuBufferStaging()
     {
         if (mp_gfxDevice->logicalDevice)
         {
+            if (mp_data)
+            {
+                vkUnmapMemory(mp_gfxDevice->logicalDevice, m_deviceMemory);
+            }
             vkDestroyBuffer(mp_gfxDevice->logicalDevice, buffer, nullptr);
             vkFreeMemory(mp_gfxDevice->logicalDevice, m_deviceMemory, nullptr);
         }
@@ -261,6 +247,33 @@ public:
     GpuBufferStaging(const GpuBufferStaging&) = delete;
     GpuBufferStaging& operator=(const GpuBufferStaging&) = delete;
 
+    // Returns pointer to the mapped (coherent) memory for writing the data.
+    uint8_t* map()
+    {
+        if (!mp_data)
+        {
+            CHECK_VK_RESULT_SUCCESS(vkMapMemory(
+                mp_gfxDevice->logicalDevice,// device
+                m_deviceMemory,             // memory
+                0,                          // offset
+                (VkDeviceSize)byteSize,     // size
+                0,                          // flags
+                &mp_data));                 // ppData
+        }
+        return (uint8_t*)mp_data;
+    }
+
+    void unmap()
+    {
+        if (mp_data)
+        {
+            vkUnmapMemory(
+                mp_gfxDevice->logicalDevice,    // device
+                m_deviceMemory);                // memory
+            mp_data = nullptr;
+        }
+    }
+
     void flushMappedRange()
     {
         const VkMappedMemoryRange mappedMemoryRange =
@@ -288,6 +301,8 @@ public:
 private:
     GfxDevice* const mp_gfxDevice   = nullptr;
     VkDeviceMemory m_deviceMemory   = nullptr;
+
+    void* mp_data = nullptr;    // mapped data pointer
 };
 
 } // namespace
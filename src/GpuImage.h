@@ -16,36 +16,46 @@
 namespace core
 {
 
+// 2D, cube (six layers) or 3D image with view, samplers are per channel (SamplerCache).
 class GpuImage
 {
 public:
     GpuImage(GfxDevice* const p_device,
-        const uint32_t width,
-        const uint32_t height,
+        const VkExtent3D extent,
+        const VkImageViewType imgViewType,
         const VkFormat imgFormat,
         const VkImageUsageFlags imgUsageFlags,
         const VkImageLayout imgLayout,
-        const VkFilter filter,
-        const VkSamplerAddressMode samplerAddressMode)
+        const VkComponentMapping componentMapping)
         : mp_device(p_device),
+        viewType(imgViewType),
         imageFormat(imgFormat),
         imageUsage(imgUsageFlags),
         imageLayout(imgLayout),
-        size{ width, height, 1 }
+        size(extent)
     {
         assert(mp_device);
         assert(size.width > 0 && size.height > 0 && size.depth > 0);
+        assert(viewType == VK_IMAGE_VIEW_TYPE_2D
+            || viewType == VK_IMAGE_VIEW_TYPE_CUBE
+            || viewType == VK_IMAGE_VIEW_TYPE_3D);
+        assert(viewType == VK_IMAGE_VIEW_TYPE_3D || size.depth == 1);
+
+        const bool isCube = (viewType == VK_IMAGE_VIEW_TYPE_CUBE);
+        layerCount = isCube ? 6 : 1;
 
         const VkImageCreateInfo imageCreateInfo =
         {
             VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,    // sType
             nullptr,                                // pNext
-            0,                                      // flags
-            VK_IMAGE_TYPE_2D,                       // imageType
+            isCube ? VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT
+                : (VkImageCreateFlags)0,            // flags
+            (viewType == VK_IMAGE_VIEW_TYPE_3D) ?
+                VK_IMAGE_TYPE_3D : VK_IMAGE_TYPE_2D,// imageType
             imageFormat,                            // format
             size,                                   // extent
             1,                                      // mipLevels
-            1,                                      // arrayLayers
+            layerCount,                             // arrayLayers
             VK_SAMPLE_COUNT_1_BIT,                  // samples
             VK_IMAGE_TILING_OPTIMAL,                // tiling
             imageUsage,                             // usage
@@ -96,20 +106,13 @@ public:
 
         // image view
 
-        constexpr VkComponentMapping componentMapping =
-        {
-            VK_COMPONENT_SWIZZLE_IDENTITY,  // r
-            VK_COMPONENT_SWIZZLE_IDENTITY,  // g
-            VK_COMPONENT_SWIZZLE_IDENTITY,  // b
-            VK_COMPONENT_SWIZZLE_IDENTITY,  // a
-        };
-        constexpr VkImageSubresourceRange imageSubresourceRange =
+        const VkImageSubresourceRange imageSubresourceRange =
         {
             VK_IMAGE_ASPECT_COLOR_BIT,  // aspectMask
             0,                          // baseMipLevel
             1,                          // levelCount
             0,                          // baseArrayLayer
-            1,                          // layerCount
+            layerCount,                 // layerCount
         };
 
         const VkImageViewCreateInfo imageViewCreateInfo =
@@ -118,7 +121,7 @@ public:
             nullptr,                                    // pNext
             0,                                          // flags
             image,                                      // image
-            VK_IMAGE_VIEW_TYPE_2D,                      // viewType
+            viewType,                                   // viewType
             imageFormat,                                // format
             componentMapping,                           // components
             imageSubresourceRange                       // subresourceRange
@@ -128,36 +131,6 @@ public:
             &imageViewCreateInfo,       // pCreateInfo
             nullptr,                    // pAllocator
             &imageView));               // pView
-
-        // sampler
-
-        const VkSamplerCreateInfo samplerCreateInfo =
-        {
-            VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,  // sType
-            nullptr,                                // pNext
-            0,                                      // flags
-            filter,                                 // magFilter
-            filter,                                 // minFilter
-            VK_SAMPLER_MIPMAP_MODE_NEAREST,         // mipmapMode
-            samplerAddressMode,                     // addressModeU
-            samplerAddressMode,                     // addressModeV
-            samplerAddressMode,                     // addressModeW
-            0.0f,                                   // mipLodBias
-            false,                                  // anisotropyEnable
-            1.0f,                                   // maxAnisotropy
-            false,                                  // compareEnable
-            VK_COMPARE_OP_NEVER,                    // compareOp
-            0.0f,                                   // minLod
-            0.0f,                                   // maxLod
-            VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK,// borderColor
-            false                                   // unnormalizedCoordinates
-        };
-
-        CHECK_VK_RESULT_SUCCESS(vkCreateSampler(
-            mp_device->logicalDevice,   // device
-            &samplerCreateInfo,         // pCreateInfo
-            nullptr,                    // pAllocator
-            &sampler));                 // pSampler
     }
 
     ~GpuImage()
@@ -166,7 +139,6 @@ public:
         {
             vkDestroyImage(mp_device->logicalDevice, image, nullptr);
             vkDestroyImageView(mp_device->logicalDevice, imageView, nullptr);
-            vkDestroySampler(mp_device->logicalDevice, sampler, nullptr);
             vkFreeMemory(mp_device->logicalDevice, m_deviceMemory, nullptr);
         }
     }
@@ -178,14 +150,15 @@ public:
 
     VkImage image                           = nullptr;
     VkImageView imageView                   = nullptr;
-    VkSampler sampler                       = nullptr;
 
+    VkImageViewType viewType                = VK_IMAGE_VIEW_TYPE_2D;
     VkFormat imageFormat                    = VK_FORMAT_UNDEFINED;
     VkImageUsageFlags imageUsage            = VK_IMAGE_USAGE_FLAG_BITS_MAX_ENUM;
     VkImageLayout imageLayout               = VK_IMAGE_LAYOUT_UNDEFINED;
     VkMemoryRequirements memoryRequirements { 0, 0, 0 };
 
     VkExtent3D size { 0, 0, 0 };
+    uint32_t layerCount = 1;
 
 private:
     GfxDevice* const mp_device      = nullptr;
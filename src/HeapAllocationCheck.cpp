@@ -0,0 +1,85 @@
+// Copyright (c) 2017 Johannes Pystynen
+// This code is licensed under the MIT license (MIT)
+
+#include "HeapAllocationCheck.h"
+
+#include <assert.h>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace core
+{
+
+// trivially initialized, so usable from operator new on any thread
+static thread_local uint32_t t_noAllocationDepth = 0;
+static std::atomic<uint64_t> s_frameAllocationCount{ 0 };
+
+NoHeapAllocationScope::NoHeapAllocationScope()
+{
+    ++t_noAllocationDepth;
+}
+
+NoHeapAllocationScope::~NoHeapAllocationScope()
+{
+    assert(t_noAllocationDepth > 0);
+    --t_noAllocationDepth;
+}
+
+uint64_t getFrameHeapAllocationCount()
+{
+    return s_frameAllocationCount.load(std::memory_order_relaxed);
+}
+
+#ifdef _DEBUG
+static void checkHeapAllocation()
+{
+    if (t_noAllocationDepth > 0)
+    {
+        s_frameAllocationCount.fetch_add(1, std::memory_order_relaxed);
+        assert(false && "Heap allocation in the steady-state frame loop");
+    }
+}
+#endif
+
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////
+
+#ifdef _DEBUG
+
+// array and sized variants forward to these by default
+
+void* operator new(std::size_t size)
+{
+    core::checkHeapAllocation();
+    void* const p_memory = std::malloc(size > 0 ? size : 1);
+    if (!p_memory)
+    {
+        throw std::bad_alloc();
+    }
+    return p_memory;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    core::checkHeapAllocation();
+    return std::malloc(size > 0 ? size : 1);
+}
+
+void operator delete(void* p_memory) noexcept
+{
+    std::free(p_memory);
+}
+
+void operator delete(void* p_memory, const std::nothrow_t&) noexcept
+{
+    std::free(p_memory);
+}
+
+#endif // _DEBUG
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,35 @@
+#ifndef CORE_HEAP_ALLOCATION_CHECK_H
+#define CORE_HEAP_ALLOCATION_CHECK_H
+
+// Copyright (c) 2017 Johannes Pystynen
+// This code is licensed under the MIT license (MIT)
+
+#include <cstdint>
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace core
+{
+
+// Debug check for heap allocations in the steady-state frame loop.
+// In debug builds the global operator new counts the allocations made on a
+// thread inside a NoHeapAllocationScope and asserts on them. Release builds do not
+// replace operator new and the scopes only track the nesting.
+class NoHeapAllocationScope
+{
+public:
+    NoHeapAllocationScope();
+    ~NoHeapAllocationScope();
+
+    NoHeapAllocationScope(const NoHeapAllocationScope&) = delete;
+    NoHeapAllocationScope& operator=(const NoHeapAllocationScope&) = delete;
+};
+
+// Heap allocations made inside NoHeapAllocationScopes (always 0 in release builds).
+uint64_t getFrameHeapAllocationCount();
+
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif // CORE_HEAP_ALLOCATION_CHECK_H
@@ -11,7 +11,9 @@
 #pragma warning(pop)
 
 #include <cstdint>
+#include <cstring>
 #include <assert.h>
+#include <fstream>
 #include <iostream>
 #include <tuple>
 
@@ -20,47 +22,263 @@
 namespace core
 {
 
+// Png bit depth from the IHDR chunk (stb_image does not report it).
+static uint32_t getPngBitDepth(const std::string& imagepath)
+{
+    constexpr uint8_t pngSignature[] = { 0x89, 'P', 'N', 'G', 0x0d, 0x0a, 0x1a, 0x0a };
+    constexpr uint32_t bitDepthOffset = 24; // signature + chunk length + type + width + height
+
+    uint8_t header[bitDepthOffset + 1] = {};
+    std::ifstream file(imagepath, std::ios::in | std::ios::binary);
+    if (file.is_open())
+    {
+        file.read((char*)header, sizeof(header));
+        if (file.gcount() == sizeof(header)
+            && std::memcmp(header, pngSignature, sizeof(pngSignature)) == 0)
+        {
+            return header[bitDepthOffset];
+        }
+    }
+    return 8;
+}
+
+static uint16_t floatToHalf(const float value)
+{
+    uint32_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    const uint32_t sign = (bits >> 16u) & 0x8000u;
+    const uint32_t floatExponent = (bits >> 23u) & 0xffu;
+    const int32_t exponent = (int32_t)floatExponent - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffffu;
+
+    if (floatExponent == 0xffu) // inf / nan
+    {
+        return (uint16_t)(sign | 0x7c00u | (mantissa ? 0x200u : 0u));
+    }
+    if (exponent >= 0x1f) // overflow -> inf
+    {
+        return (uint16_t)(sign | 0x7c00u);
+    }
+    if (exponent <= 0) // denormal or zero
+    {
+        if (exponent < -10)
+        {
+            return (uint16_t)sign;
+        }
+        mantissa |= 0x800000u;
+        const uint32_t shift = (uint32_t)(14 - exponent);
+        uint32_t half = mantissa >> shift;
+        half += (mantissa >> (shift - 1u)) & 1u; // round
+        return (uint16_t)(sign | half);
+    }
+
+    uint32_t half = sign | ((uint32_t)exponent << 10u) | (mantissa >> 13u);
+    half += (mantissa >> 12u) & 1u; // round, carry to exponent is fine
+    return (uint16_t)half;
+}
+
+uint32_t getImageComponentByteSize(const ImageComponentType componentType)
+{
+    switch (componentType)
+    {
+    case ImageComponentType::unorm8:
+        return 1;
+    case ImageComponentType::unorm16:
+    case ImageComponentType::sfloat16:
+        return 2;
+    case ImageComponentType::sfloat32:
+        return 4;
+    default:
+        assert(false);
+        return 0;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 ImageLoader::ImageLoader(const std::string& imagepath)
+    : m_imagePath(imagepath)
 {
-    loadStbImage(imagepath);
+    if (!loadVolumeInfo(imagepath))
+    {
+        loadStbImageInfo(imagepath);
+    }
 }
 
-void ImageLoader::loadStbImage(const std::string& imagepath)
+bool ImageLoader::loadVolumeInfo(const std::string& imagepath)
+{
+    constexpr char volumeMagic[] = { 'V', 'O', 'L', '8' };
+
+    VolumeHeader header{};
+    std::ifstream file(imagepath, std::ios::in | std::ios::binary);
+    if (file.is_open())
+    {
+        file.read((char*)&header, sizeof(header));
+        if (file.gcount() == sizeof(header)
+            && std::memcmp(header.magic, volumeMagic, sizeof(volumeMagic)) == 0)
+        {
+            m_volume = true;
+            if (header.width > 0 && header.height > 0 && header.depth > 0
+                && (header.channelCount == 1 || header.channelCount == 2 || header.channelCount == 4))
+            {
+                m_size = std::make_tuple(header.width, header.height, header.depth);
+                m_channelCount = header.channelCount;
+            }
+            else
+            {
+                std::cerr << "invalid volume header: " << imagepath;
+            }
+        }
+    }
+    return m_volume;
+}
+
+void ImageLoader::loadStbImageInfo(const std::string& imagepath)
 {
     int x = 0;  // width
     int y = 0;  // height
     int n = 0;  // channels per pixel
-    uint8_t* p_data = stbi_load(imagepath.c_str(), &x, &y, &n, STBI_rgb_alpha);
+    if (stbi_info(imagepath.c_str(), &x, &y, &n) != 0)
+    {
+        m_size = std::make_tuple(x, y, 1);
+        // rgb formats are not generally supported for sampling
+        m_channelCount = (n == 3) ? 4 : n;
 
-    if (p_data != nullptr)
+        if (stbi_is_hdr(imagepath.c_str()))
+        {
+            m_componentType = ImageComponentType::sfloat32;
+            m_channelDepth = 32;
+        }
+        else if (getPngBitDepth(imagepath) == 16)
+        {
+            m_componentType = ImageComponentType::unorm16;
+            m_channelDepth = 16;
+        }
+    }
+    else
     {
-        m_size = std::make_tuple(x, y);
-        m_channelCount = 4; // forced
+        std::cerr << "image file not found: " << imagepath;
+    }
+}
 
-        m_bytesize = x * y * m_channelCount; // one channel one byte
-        m_byteData.resize(m_bytesize);
+bool ImageLoader::decode(uint8_t* const p_dst,
+    const ImageComponentType dstComponentType,
+    const uint32_t dstChannelCount) const
+{
+    assert(p_dst);
+    assert(dstChannelCount == 0 || dstChannelCount == m_channelCount || dstChannelCount == 4);
+    if (!isValid())
+    {
+        return false;
+    }
+    if (m_volume)
+    {
+        assert(dstComponentType == ImageComponentType::unorm8);
+        assert(dstChannelCount == 0 || dstChannelCount == m_channelCount);
+        return decodeVolume(p_dst);
+    }
+
+    // stb_image always decodes to its own buffer (png unfiltering reads back
+    // the previous row, which we do not want to do from mapped gpu memory),
+    // so this is the only copy (or conversion) of the pixel data.
+    int x = 0;  // width
+    int y = 0;  // height
+    int n = 0;  // channels per pixel
+    const uint32_t channelCount = (dstChannelCount > 0) ? dstChannelCount : m_channelCount;
+    const int reqComp = (int)channelCount;
+    void* p_data = nullptr;
+    switch (m_componentType)
+    {
+    case ImageComponentType::unorm8:
+        p_data = stbi_load(m_imagePath.c_str(), &x, &y, &n, reqComp);
+        break;
+    case ImageComponentType::unorm16:
+        p_data = stbi_load_16(m_imagePath.c_str(), &x, &y, &n, reqComp);
+        break;
+    case ImageComponentType::sfloat32:
+        p_data = stbi_loadf(m_imagePath.c_str(), &x, &y, &n, reqComp);
+        break;
+    default:
+        break;
+    }
 
-        std::memcpy(m_byteData.data(), p_data, m_bytesize);
+    const bool valid = (p_data != nullptr)
+        && (std::make_tuple((uint32_t)x, (uint32_t)y, 1u) == m_size);
+    if (valid)
+    {
+        const uint32_t componentCount = (uint32_t)x * (uint32_t)y * channelCount;
+        if (dstComponentType == m_componentType)
+        {
+            std::memcpy(p_dst, p_data, getBytesize(dstComponentType, channelCount));
+        }
+        else if (m_componentType == ImageComponentType::unorm16
+            && dstComponentType == ImageComponentType::sfloat16)
+        {
+            const uint16_t* const p_src = (const uint16_t*)p_data;
+            uint16_t* const p_half = (uint16_t*)p_dst;
+            for (uint32_t idx = 0; idx < componentCount; ++idx)
+            {
+                p_half[idx] = floatToHalf((float)p_src[idx] * (1.0f / 65535.0f));
+            }
+        }
+        else if (m_componentType == ImageComponentType::sfloat32
+            && dstComponentType == ImageComponentType::sfloat16)
+        {
+            const float* const p_src = (const float*)p_data;
+            uint16_t* const p_half = (uint16_t*)p_dst;
+            for (uint32_t idx = 0; idx < componentCount; ++idx)
+            {
+                p_half[idx] = floatToHalf(p_src[idx]);
+            }
+        }
+        else
+        {
+            assert(false && "Unsupported image component conversion");
+        }
     }
     else
     {
-        std::cerr << "image file not found: " << imagepath;
+        std::cerr << "image decoding failed: " << m_imagePath;
     }
 
     stbi_image_free(p_data);
+
+    return valid;
 }
 
-uint8_t* ImageLoader::getData()
+bool ImageLoader::decodeVolume(uint8_t* const p_dst) const
 {
-    return m_byteData.data();
+    // raw data, read straight to the destination
+    const uint32_t bytesize = getBytesize(ImageComponentType::unorm8);
+    std::ifstream file(m_imagePath, std::ios::in | std::ios::binary);
+    if (file.is_open())
+    {
+        file.seekg(sizeof(VolumeHeader));
+        file.read((char*)p_dst, bytesize);
+        if (file.gcount() == (std::streamsize)bytesize)
+        {
+            return true;
+        }
+    }
+    std::cerr << "volume decoding failed: " << m_imagePath;
+    return false;
+}
+
+bool ImageLoader::isValid() const
+{
+    return m_channelCount > 0;
 }
 
-uint32_t ImageLoader::getBytesize() const
+uint32_t ImageLoader::getBytesize(const ImageComponentType dstComponentType,
+    const uint32_t dstChannelCount) const
 {
-    return m_bytesize;
+    const uint32_t channelCount = (dstChannelCount > 0) ? dstChannelCount : m_channelCount;
+    return std::get<0>(m_size) * std::get<1>(m_size) * std::get<2>(m_size)
+        * channelCount * getImageComponentByteSize(dstComponentType);
 }
 
-std::tuple<uint32_t, uint32_t> ImageLoader::getSize() const
+std::tuple<uint32_t, uint32_t, uint32_t> ImageLoader::getSize() const
 {
     return m_size;
 }
@@ -70,6 +288,11 @@ uint32_t ImageLoader::getChannelCount() const
     return m_channelCount;
 }
 
+ImageComponentType ImageLoader::getComponentType() const
+{
+    return m_componentType;
+}
+
 } // namespace
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -7,13 +7,39 @@
 #include <cstdint>
 #include <string>
 #include <tuple>
-#include <vector>
 
 ///////////////////////////////////////////////////////////////////////////////
 
 namespace core
 {
 
+// Component type of the image data.
+enum class ImageComponentType : uint32_t
+{
+    unorm8      = 0,
+    unorm16     = 1,
+    sfloat16    = 2,
+    sfloat32    = 3,
+};
+
+uint32_t getImageComponentByteSize(const ImageComponentType componentType);
+
+// Raw volume file header, followed by
+// width * height * depth * channelCount bytes (x fastest, then y, then z).
+struct VolumeHeader
+{
+    char magic[4];          // "VOL8"
+    uint32_t width;
+    uint32_t height;
+    uint32_t depth;
+    uint32_t channelCount;  // 1, 2 or 4
+};
+
+// Reads the image header on construction. The pixel data is decoded
+// with decode() directly to caller owned memory (e.g. mapped staging buffer).
+// Keeps the source channel count (rgb is padded to rgba) and bit depth:
+// 8-bit -> unorm8, 16-bit png -> unorm16, hdr -> sfloat32.
+// Raw volume files (see VolumeHeader) are loaded as unorm8 with depth > 1.
 class ImageLoader
 {
 public:
@@ -23,21 +49,36 @@ public:
     ImageLoader(const ImageLoader&) = delete;
     ImageLoader& operator=(const ImageLoader&) = delete;
 
-    uint32_t getBytesize() const;
-    uint8_t* getData();
+    // Decodes and converts the source data to dstComponentType.
+    // A dstChannelCount of 4 expands grey(-alpha) images to rgba (grey in rgb), 0 keeps the channels.
+    // p_dst needs to have room for getBytesize(dstComponentType, dstChannelCount) bytes.
+    bool decode(uint8_t* const p_dst,
+        const ImageComponentType dstComponentType,
+        const uint32_t dstChannelCount = 0) const;
+
+    bool isValid() const;
+    uint32_t getBytesize(const ImageComponentType dstComponentType,
+        const uint32_t dstChannelCount = 0) const;
 
-    std::tuple<uint32_t, uint32_t> getSize() const;
+    // width, height, depth
+    std::tuple<uint32_t, uint32_t, uint32_t> getSize() const;
     uint32_t getChannelCount() const;
+    ImageComponentType getComponentType() const;
 
 private:
-    void loadStbImage(const std::string& imagePath);
+    bool loadVolumeInfo(const std::string& imagePath);
+    void loadStbImageInfo(const std::string& imagePath);
+
+    bool decodeVolume(uint8_t* const p_dst) const;
+
+    std::string m_imagePath;
 
-    std::tuple<uint32_t, uint32_t> m_size;
+    std::tuple<uint32_t, uint32_t, uint32_t> m_size;
+    bool m_volume = false;
     uint32_t m_channelCount = 0;
     uint32_t m_channelDepth = 8;
-    uint32_t m_bytesize     = 0;
 
-    std::vector<uint8_t> m_byteData;
+    ImageComponentType m_componentType = ImageComponentType::unorm8;
 };
 
 } // namespace
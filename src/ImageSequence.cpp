@@ -0,0 +1,188 @@
+// Copyright (c) 2017 Johannes Pystynen
+// This code is licensed under the MIT license (MIT)
+
+#include "ImageSequence.h"
+
+#include "GfxResources.h"
+#include "GpuBuffer.h"
+#include "ImageLoader.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace core
+{
+
+ImageSequence::ImageSequence(GfxDevice* const p_gfxDevice,
+    const std::vector<std::string>& frameFiles,
+    const float framesPerSecond,
+    const ImageComponentType componentType,
+    const uint32_t channelCount,
+    const uint32_t frameByteSize,
+    const uint32_t inFlightFrameCount)
+    : m_frameFiles(frameFiles),
+    m_framesPerSecond(framesPerSecond),
+    m_componentType(componentType),
+    m_channelCount(channelCount),
+    m_frameByteSize(frameByteSize)
+{
+    assert(p_gfxDevice);
+    assert(m_frameFiles.size() > 0);
+    assert(m_framesPerSecond > 0.0f);
+    assert(m_frameByteSize > 0);
+
+    // a slot per frame in flight (in use until its fence), one being decoded and one ready
+    m_slots.resize(inFlightFrameCount + 2);
+    for (auto&& slotRef : m_slots)
+    {
+        slotRef.stagingBuffer.reset(new GpuBufferStaging(p_gfxDevice, m_frameByteSize));
+        slotRef.p_data = slotRef.stagingBuffer->map();
+    }
+
+    m_sourceComponentType = ImageLoader(m_frameFiles[0]).getComponentType();
+    m_badFrames.resize(m_frameFiles.size(), false);
+
+    // the first frame is always ready for the first upload
+    if (decodeFrame(0, 0))
+    {
+        m_slots[0].state = SlotState::ready;
+        m_readySlots.push_back(0);
+    }
+    else
+    {
+        m_badFrames[0] = true;
+        ++m_badFrameCount;
+    }
+    m_decodeFrame = 1;
+
+    m_worker = std::thread(&ImageSequence::decodeLoop, this);
+}
+
+ImageSequence::~ImageSequence()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_condition.notify_one();
+    if (m_worker.joinable())
+    {
+        m_worker.join();
+    }
+}
+
+int32_t ImageSequence::acquireFrame(const float timeSeconds)
+{
+    int32_t acquiredSlot = -1;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_started)
+        {
+            m_started = true;
+            m_startTime = timeSeconds;
+        }
+        const float playTime = std::max(0.0f, timeSeconds - m_startTime);
+        m_targetFrame = (uint64_t)(playTime * m_framesPerSecond);
+
+        // take the newest ready frame, skip older ones if decoding fell behind
+        while (!m_readySlots.empty() && m_slots[m_readySlots.front()].frame <= m_targetFrame)
+        {
+            if (acquiredSlot >= 0)
+            {
+                m_slots[acquiredSlot].state = SlotState::free;
+            }
+            acquiredSlot = (int32_t)m_readySlots.front();
+            m_readySlots.pop_front();
+        }
+        if (acquiredSlot >= 0)
+        {
+            m_slots[acquiredSlot].state = SlotState::inUse;
+        }
+    }
+    m_condition.notify_one();
+    return acquiredSlot;
+}
+
+void ImageSequence::releaseFrame(const int32_t slot)
+{
+    assert(slot >= 0 && slot < (int32_t)m_slots.size());
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        assert(m_slots[slot].state == SlotState::inUse);
+        m_slots[slot].state = SlotState::free;
+    }
+    m_condition.notify_one();
+}
+
+GpuBufferStaging* ImageSequence::getStagingBuffer(const int32_t slot)
+{
+    assert(slot >= 0 && slot < (int32_t)m_slots.size());
+    return m_slots[slot].stagingBuffer.get();
+}
+
+void ImageSequence::decodeLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stop)
+    {
+        auto slotIter = std::find_if(m_slots.begin(), m_slots.end(),
+            [](const Slot& slot) { return slot.state == SlotState::free; });
+        // nothing to decode if no frame file is valid, waits for the stop
+        if (slotIter == m_slots.end() || m_badFrameCount == m_frameFiles.size())
+        {
+            m_condition.wait(lock);
+            continue;
+        }
+
+        // jump ahead if the playback has passed the decoding, the bad frames are skipped
+        uint64_t frame = std::max(m_decodeFrame, m_targetFrame);
+        while (m_badFrames[frame % m_frameFiles.size()])
+        {
+            ++frame;
+        }
+        const uint32_t slot = (uint32_t)(slotIter - m_slots.begin());
+        slotIter->state = SlotState::decoding;
+
+        lock.unlock();
+        const bool decoded = decodeFrame(frame, slot);
+        lock.lock();
+
+        if (decoded)
+        {
+            m_slots[slot].state = SlotState::ready;
+            m_slots[slot].frame = frame;
+            m_readySlots.push_back(slot);
+        }
+        else
+        {
+            // reported once, the file is not read again
+            m_slots[slot].state = SlotState::free;
+            m_badFrames[frame % m_frameFiles.size()] = true;
+            ++m_badFrameCount;
+        }
+        m_decodeFrame = frame + 1;
+    }
+}
+
+bool ImageSequence::decodeFrame(const uint64_t frame, const uint32_t slot)
+{
+    const std::string& frameFile = m_frameFiles[frame % m_frameFiles.size()];
+    ImageLoader imgLoader(frameFile);
+    if (!imgLoader.isValid()
+        || imgLoader.getComponentType() != m_sourceComponentType
+        || imgLoader.getBytesize(m_componentType, m_channelCount) != m_frameByteSize)
+    {
+        std::cerr << "image sequence frame does not match the first frame: " << frameFile << std::endl;
+        return false;
+    }
+    return imgLoader.decode(m_slots[slot].p_data, m_componentType, m_channelCount);
+}
+
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,100 @@
+#ifndef CORE_IMAGE_SEQUENCE_H
+#define CORE_IMAGE_SEQUENCE_H
+
+// Copyright (c) 2017 Johannes Pystynen
+// This code is licensed under the MIT license (MIT)
+
+#include "ImageLoader.h"
+#include "ImageStream.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace core
+{
+
+class GfxDevice;
+class GpuBufferStaging;
+
+// Plays back a numbered image sequence (e.g. channel0_0000.png, channel0_0001.png, ...).
+// A worker thread decodes frames ahead into a ring of mapped staging buffers.
+class ImageSequence : public ImageStream
+{
+public:
+    ImageSequence(GfxDevice* const p_gfxDevice,
+        const std::vector<std::string>& frameFiles,
+        const float framesPerSecond,
+        const ImageComponentType componentType,
+        const uint32_t channelCount,
+        const uint32_t frameByteSize,
+        const uint32_t inFlightFrameCount);
+    ~ImageSequence() override;
+
+    ImageSequence(const ImageSequence&) = delete;
+    ImageSequence& operator=(const ImageSequence&) = delete;
+
+    int32_t acquireFrame(const float timeSeconds) override;
+    void releaseFrame(const int32_t slot) override;
+
+    GpuBufferStaging* getStagingBuffer(const int32_t slot) override;
+
+private:
+    void decodeLoop();
+    bool decodeFrame(const uint64_t frame, const uint32_t slot);
+
+    enum class SlotState : uint32_t
+    {
+        free        = 0,
+        decoding    = 1,
+        ready       = 2,
+        inUse       = 3,
+    };
+
+    struct Slot
+    {
+        std::unique_ptr<GpuBufferStaging> stagingBuffer;
+        uint8_t* p_data = nullptr;  // persistently mapped
+
+        SlotState state = SlotState::free;
+        uint64_t frame  = 0;
+    };
+
+    const std::vector<std::string> m_frameFiles;
+    const float m_framesPerSecond               = 30.0f;
+    const ImageComponentType m_componentType    = ImageComponentType::unorm8;
+    const uint32_t m_channelCount               = 0;    // decoded, can be more than in the files
+    const uint32_t m_frameByteSize              = 0;
+    ImageComponentType m_sourceComponentType    = ImageComponentType::unorm8;
+
+    std::vector<Slot> m_slots;
+    std::deque<uint32_t> m_readySlots; // in decoding order
+
+    // frame files which failed to decode are skipped, until the sequence is recreated
+    std::vector<bool> m_badFrames;
+    size_t m_badFrameCount  = 0;
+
+    uint64_t m_decodeFrame  = 0;    // next frame for the worker
+    uint64_t m_targetFrame  = 0;    // current playback frame
+
+    bool m_started      = false;
+    float m_startTime   = 0.0f;
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::thread m_worker;
+    bool m_stop = false;
+};
+
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif // CORE_IMAGE_SEQUENCE_H
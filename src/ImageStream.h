@@ -0,0 +1,37 @@
+#ifndef CORE_IMAGE_STREAM_H
+#define CORE_IMAGE_STREAM_H
+
+// Copyright (c) 2017 Johannes Pystynen
+// This code is licensed under the MIT license (MIT)
+
+#include <cstdint>
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace core
+{
+
+class GpuBufferStaging;
+
+// Channel image data which changes over time (image sequence, audio analysis).
+// Frames are produced to mapped staging buffers (slots) by a worker thread,
+// the renderer copies the acquired slot to the channel image and releases
+// the slot when the command buffer has finished.
+class ImageStream
+{
+public:
+    virtual ~ImageStream() = default;
+
+    // Returns the slot of the newest ready frame for the time or -1 if there
+    // is no new frame. Never waits for the worker.
+    virtual int32_t acquireFrame(const float timeSeconds) = 0;
+    virtual void releaseFrame(const int32_t slot) = 0;
+
+    virtual GpuBufferStaging* getStagingBuffer(const int32_t slot) = 0;
+};
+
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif // CORE_IMAGE_STREAM_H
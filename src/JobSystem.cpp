@@ -0,0 +1,260 @@
+// Copyright (c) 2017 Johannes Pystynen
+// This code is licensed under the MIT license (MIT)
+
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <mutex>
+#include <thread>
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+
+// worker index of the current thread in its job system
+thread_local const core::JobSystem* tp_jobSystem = nullptr;
+thread_local int32_t t_workerIndex = -1;
+
+} // namespace
+
+namespace core
+{
+
+JobSystem::JobSystem(const uint32_t threadCount)
+{
+    uint32_t workerCount = threadCount;
+    if (workerCount == 0)
+    {
+        const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        workerCount = std::max(1u, hardwareThreads > 1 ? hardwareThreads - 1 : 1u);
+    }
+
+    for (uint32_t idx = 0; idx < workerCount; ++idx)
+    {
+        m_queues.emplace_back(new WorkerQueue());
+    }
+    for (uint32_t idx = 0; idx < workerCount; ++idx)
+    {
+        m_workers.emplace_back(&JobSystem::workerLoop, this, idx);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    // the workers drain the queues before stopping, queued jobs and their dependents still run
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stop = true;
+    }
+    m_sleepCondition.notify_all();
+    for (auto&& workerRef : m_workers)
+    {
+        workerRef.join();
+    }
+    assert(m_queuedCount.load() == 0);
+}
+
+JobSystem::JobHandle JobSystem::run(std::function<void()> func,
+    const std::vector<JobHandle>& dependencies)
+{
+    JobHandle job = std::make_shared<Job>();
+    job->func = std::move(func);
+    job->pendingCount.store((uint32_t)dependencies.size() + 1, std::memory_order_relaxed);
+
+    for (const auto& dependencyRef : dependencies)
+    {
+        assert(dependencyRef);
+        bool finished = false;
+        {
+            std::lock_guard<std::mutex> lock(dependencyRef->mutex);
+            finished = dependencyRef->finished;
+            if (!finished)
+            {
+                dependencyRef->dependents.push_back(job);
+            }
+        }
+        if (finished)
+        {
+            releaseDependency(job, dependencyRef->exception);
+        }
+    }
+    releaseDependency(job, nullptr);
+    return job;
+}
+
+void JobSystem::wait(const JobHandle& job)
+{
+    wait(std::vector<JobHandle>{ job });
+}
+
+void JobSystem::wait(const std::vector<JobHandle>& jobs)
+{
+    const int32_t workerIndex = getWorkerIndex();
+    for (const auto& jobRef : jobs)
+    {
+        while (!jobRef->isDone())
+        {
+            if (tryRunJob(workerIndex))
+            {
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            m_sleepCondition.wait(lock, [this, &jobRef]()
+            {
+                return jobRef->isDone() || m_queuedCount.load() > 0;
+            });
+        }
+    }
+    for (const auto& jobRef : jobs)
+    {
+        if (jobRef->exception)
+        {
+            std::rethrow_exception(jobRef->exception);
+        }
+    }
+}
+
+uint32_t JobSystem::getThreadCount() const
+{
+    return (uint32_t)m_workers.size();
+}
+
+void JobSystem::workerLoop(const uint32_t workerIndex)
+{
+    tp_jobSystem = this;
+    t_workerIndex = (int32_t)workerIndex;
+
+    for (;;)
+    {
+        if (tryRunJob((int32_t)workerIndex))
+        {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_sleepCondition.wait(lock, [this]()
+        {
+            return m_stop || m_queuedCount.load() > 0;
+        });
+        if (m_stop && m_queuedCount.load() == 0)
+        {
+            return;
+        }
+    }
+}
+
+void JobSystem::enqueue(JobHandle job)
+{
+    // own queue for jobs spawned by workers, round robin for others
+    const int32_t workerIndex = getWorkerIndex();
+    const uint32_t queueIndex = (workerIndex >= 0) ?
+        (uint32_t)workerIndex :
+        m_nextQueue.fetch_add(1, std::memory_order_relaxed) % (uint32_t)m_queues.size();
+    {
+        std::lock_guard<std::mutex> lock(m_queues[queueIndex]->mutex);
+        m_queues[queueIndex]->jobs.push_back(std::move(job));
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_queuedCount.fetch_add(1);
+    }
+    m_sleepCondition.notify_all();
+}
+
+bool JobSystem::tryRunJob(const int32_t workerIndex)
+{
+    JobHandle job;
+    const uint32_t queueCount = (uint32_t)m_queues.size();
+
+    // newest job from the own queue (cache friendly), then steal the oldest from others
+    if (workerIndex >= 0)
+    {
+        WorkerQueue& queue = *m_queues[workerIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.jobs.empty())
+        {
+            job = std::move(queue.jobs.back());
+            queue.jobs.pop_back();
+        }
+    }
+    const uint32_t firstVictim = (workerIndex >= 0) ? (uint32_t)workerIndex + 1 : 0;
+    for (uint32_t idx = 0; !job && idx < queueCount; ++idx)
+    {
+        WorkerQueue& queue = *m_queues[(firstVictim + idx) % queueCount];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.jobs.empty())
+        {
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+        }
+    }
+
+    if (!job)
+    {
+        return false;
+    }
+    m_queuedCount.fetch_sub(1);
+    execute(job);
+    return true;
+}
+
+void JobSystem::execute(const JobHandle& job)
+{
+    // a job whose dependency failed is skipped, it already has the exception of the dependency
+    if (!job->exception)
+    {
+        try
+        {
+            job->func();
+        }
+        catch (...)
+        {
+            job->exception = std::current_exception();
+        }
+    }
+    job->func = nullptr;
+
+    std::vector<JobHandle> dependents;
+    {
+        std::lock_guard<std::mutex> lock(job->mutex);
+        job->finished = true;
+        dependents.swap(job->dependents);
+    }
+    for (const auto& dependentRef : dependents)
+    {
+        releaseDependency(dependentRef, job->exception);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        job->done.store(true, std::memory_order_release);
+    }
+    m_sleepCondition.notify_all();
+}
+
+void JobSystem::releaseDependency(const JobHandle& job, const std::exception_ptr& exception)
+{
+    if (exception)
+    {
+        // first failed dependency wins, the job is skipped and waiting on it rethrows
+        std::lock_guard<std::mutex> lock(job->mutex);
+        if (!job->exception)
+        {
+            job->exception = exception;
+        }
+    }
+    if (job->pendingCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        enqueue(job);
+    }
+}
+
+int32_t JobSystem::getWorkerIndex() const
+{
+    return (tp_jobSystem == this) ? t_workerIndex : -1;
+}
+
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,103 @@
+#ifndef CORE_JOB_SYSTEM_H
+#define CORE_JOB_SYSTEM_H
+
+// Copyright (c) 2017 Johannes Pystynen
+// This code is licensed under the MIT license (MIT)
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace core
+{
+
+// Work-stealing thread pool for engine tasks (image decoding, shader compiling, ...).
+// Every worker has its own queue: new jobs from a worker go to its own queue
+// and idle workers steal the oldest jobs from the others. A job can depend on
+// other jobs and is queued when all of them have finished; if one of them threw,
+// the job is skipped and gets its exception. Threads waiting for jobs run queued
+// jobs meanwhile, so jobs can wait for other jobs.
+class JobSystem
+{
+public:
+    class Job;
+    using JobHandle = std::shared_ptr<Job>;
+
+    // threadCount 0: one worker per hardware thread except the calling thread
+    explicit JobSystem(const uint32_t threadCount = 0);
+    // Runs the queued jobs before stopping the workers.
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    JobHandle run(std::function<void()> func,
+        const std::vector<JobHandle>& dependencies = {});
+
+    // Waits for the jobs and rethrows the first exception thrown by them.
+    void wait(const JobHandle& job);
+    void wait(const std::vector<JobHandle>& jobs);
+
+    uint32_t getThreadCount() const;
+
+    class Job
+    {
+    public:
+        bool isDone() const { return done.load(std::memory_order_acquire); }
+
+    private:
+        friend class JobSystem;
+
+        std::function<void()> func;
+        std::exception_ptr exception;       // own or of a failed dependency
+
+        // dependencies left + 1 until the job is queued
+        std::atomic<uint32_t> pendingCount{ 1 };
+        std::atomic<bool> done{ false };
+
+        std::mutex mutex;
+        bool finished = false;              // guarded by mutex
+        std::vector<JobHandle> dependents;  // guarded by mutex
+    };
+
+private:
+    struct WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<JobHandle> jobs;
+    };
+
+    void workerLoop(const uint32_t workerIndex);
+    void enqueue(JobHandle job);
+    bool tryRunJob(const int32_t workerIndex);
+    void execute(const JobHandle& job);
+    void releaseDependency(const JobHandle& job, const std::exception_ptr& exception);
+    int32_t getWorkerIndex() const;
+
+    std::vector<std::unique_ptr<WorkerQueue> > m_queues;
+    std::vector<std::thread> m_workers;
+
+    std::atomic<uint32_t> m_queuedCount{ 0 };
+    std::atomic<uint32_t> m_nextQueue{ 0 };   // for jobs from non-worker threads
+
+    // idle workers and waiting threads sleep here,
+    // woken up when a job is queued or finishes
+    std::mutex m_sleepMutex;
+    std::condition_variable m_sleepCondition;
+    bool m_stop = false;
+};
+
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif // CORE_JOB_SYSTEM_H
@@ -3,20 +3,29 @@
 
 #include "Renderer.h"
 
+#include "AudioAnalyzer.h"
 #include "DescriptorSet.h"
+#include "FileDirectoryWatcher.h"
 #include "GfxResources.h"
 #include "GpuBuffer.h"
 #include "GpuImage.h"
+#include "HeapAllocationCheck.h"
 #include "ImageLoader.h"
+#include "ImageSequence.h"
 #include "ResourceList.h"
 #include "ShaderCompiler.h"
 #include "Shader.h"
+#include "Utils.h"
 #include "Window.h"
 
+#include <algorithm>
 #include <assert.h>
 #include <cstdint>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <memory>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -27,22 +36,358 @@
 namespace core
 {
 
-Renderer::Renderer(GfxResources* const p_gfxResources, Window* const p_window)
+struct ImageFormat
+{
+    VkFormat format                     = VK_FORMAT_UNDEFINED;
+    ImageComponentType componentType    = ImageComponentType::unorm8;
+    uint32_t channelCount               = 0; // of the decoded data, 4 if grey(-alpha) is expanded
+};
+
+// Returns the tightest sampled and linear filterable format supported by the device.
+// One and two channel srgb images are expanded to rgba if only the rgba srgb format is supported.
+static ImageFormat getImageFormat(
+    GfxDevice* const p_gfxDevice,
+    const uint32_t channelCount,
+    const ImageComponentType componentType,
+    const bool srgb)
+{
+    assert(channelCount == 1 || channelCount == 2 || channelCount == 4);
+    const uint32_t channelIndex = (channelCount == 4) ? 2 : channelCount - 1;
+
+    // candidates in preferred order for 1, 2 and 4 channels
+    std::vector<ImageFormat> candidates;
+    switch (componentType)
+    {
+    case ImageComponentType::unorm8:
+    {
+        const VkFormat srgbFormats[] =
+        { VK_FORMAT_R8_SRGB, VK_FORMAT_R8G8_SRGB, VK_FORMAT_R8G8B8A8_SRGB };
+        const VkFormat unormFormats[] =
+        { VK_FORMAT_R8_UNORM, VK_FORMAT_R8G8_UNORM, VK_FORMAT_R8G8B8A8_UNORM };
+        if (srgb)
+        {
+            candidates.push_back({ srgbFormats[channelIndex], ImageComponentType::unorm8, channelCount });
+            if (channelCount < 4)
+            {
+                candidates.push_back({ VK_FORMAT_R8G8B8A8_SRGB, ImageComponentType::unorm8, 4 });
+            }
+        }
+        candidates.push_back({ unormFormats[channelIndex], ImageComponentType::unorm8, channelCount });
+    } break;
+    case ImageComponentType::unorm16:
+    {
+        const VkFormat unormFormats[] =
+        { VK_FORMAT_R16_UNORM, VK_FORMAT_R16G16_UNORM, VK_FORMAT_R16G16B16A16_UNORM };
+        const VkFormat floatFormats[] =
+        { VK_FORMAT_R16_SFLOAT, VK_FORMAT_R16G16_SFLOAT, VK_FORMAT_R16G16B16A16_SFLOAT };
+        candidates.push_back({ unormFormats[channelIndex], ImageComponentType::unorm16, channelCount });
+        candidates.push_back({ floatFormats[channelIndex], ImageComponentType::sfloat16, channelCount });
+    } break;
+    case ImageComponentType::sfloat16:
+    case ImageComponentType::sfloat32:
+    {
+        const VkFormat halfFormats[] =
+        { VK_FORMAT_R16_SFLOAT, VK_FORMAT_R16G16_SFLOAT, VK_FORMAT_R16G16B16A16_SFLOAT };
+        const VkFormat floatFormats[] =
+        { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+        candidates.push_back({ halfFormats[channelIndex], ImageComponentType::sfloat16, channelCount });
+        candidates.push_back({ floatFormats[channelIndex], ImageComponentType::sfloat32, channelCount });
+    } break;
+    default:
+        assert(false);
+        break;
+    }
+
+    constexpr VkFormatFeatureFlags requiredFeatures =
+        VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    for (const auto& candidateRef : candidates)
+    {
+        VkFormatProperties formatProperties{};
+        vkGetPhysicalDeviceFormatProperties(
+            p_gfxDevice->physicalDevice,    // physicalDevice
+            candidateRef.format,            // format
+            &formatProperties);             // pFormatProperties
+        if ((formatProperties.optimalTilingFeatures & requiredFeatures) == requiredFeatures)
+        {
+            return candidateRef;
+        }
+    }
+
+    // there is always a candidate with mandatory sampling support
+    assert(false && "Image format not supported");
+    return candidates.back();
+}
+
+// Grey and grey-alpha images are sampled as rgb(a) like before.
+static VkComponentMapping getComponentMapping(const uint32_t channelCount)
+{
+    switch (channelCount)
+    {
+    case 1:
+        return { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R,
+            VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_ONE };
+    case 2:
+        return { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R,
+            VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G };
+    default:
+        return { VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY,
+            VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY };
+    }
+}
+
+static bool fileExists(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::in | std::ios::binary);
+    return file.is_open();
+}
+
+static std::vector<std::string> getCubeFaceFiles(
+    const std::string& channelName,
+    const std::string& extension)
+{
+    ResourceList& rl = ResourceList::getInstance();
+    std::vector<std::string> faceFiles;
+    for (const auto& suffixRef : rl.imageCubeFaceSuffixes)
+    {
+        faceFiles.emplace_back(rl.imagePath + "/" + channelName + suffixRef + extension);
+    }
+    return faceFiles;
+}
+
+// Returns the numbered frames of a channel sequence (empty if there is no first frame).
+static std::vector<std::string> getSequenceFrameFiles(const std::string& channelName)
+{
+    ResourceList& rl = ResourceList::getInstance();
+    std::vector<std::string> frameFiles;
+    for (const auto& extensionRef : rl.imageSequenceExtensions)
+    {
+        std::string frameFile = rl.imagePath + "/"
+            + rl.getImageSequenceFrameName(channelName, 0) + extensionRef;
+        while (fileExists(frameFile))
+        {
+            frameFiles.emplace_back(frameFile);
+            frameFile = rl.imagePath + "/"
+                + rl.getImageSequenceFrameName(channelName, (uint32_t)frameFiles.size()) + extensionRef;
+        }
+        if (!frameFiles.empty())
+        {
+            break;
+        }
+    }
+    return frameFiles;
+}
+
+static std::string getChannelShaderDefine(const uint32_t index, const VkImageViewType viewType)
+{
+    switch (viewType)
+    {
+    case VK_IMAGE_VIEW_TYPE_CUBE:
+        return "#define DEF_CHANNEL" + std::to_string(index) + "_CUBE 1\n";
+    case VK_IMAGE_VIEW_TYPE_3D:
+        return "#define DEF_CHANNEL" + std::to_string(index) + "_3D 1\n";
+    default:
+        return "";
+    }
+}
+
+// Image files of a channel which is not a sequence, same selection as in beginChannel.
+// Audio is streamed and has no files here.
+static std::vector<std::string> getChannelImageFiles(const uint32_t index, VkImageViewType& viewType)
+{
+    ResourceList& rl = ResourceList::getInstance();
+    const std::string& channelName = rl.imageFilesForSearch[index];
+    viewType = VK_IMAGE_VIEW_TYPE_2D;
+    const std::vector<std::string> faceFiles = getCubeFaceFiles(channelName, ".png");
+    const std::string volumeFile = rl.imagePath + "/" + channelName + rl.imageVolumeExtension;
+    if (fileExists(faceFiles[0]))
+    {
+        viewType = VK_IMAGE_VIEW_TYPE_CUBE;
+        return faceFiles;
+    }
+    else if (fileExists(volumeFile))
+    {
+        viewType = VK_IMAGE_VIEW_TYPE_3D;
+        return { volumeFile };
+    }
+    else if (fileExists(rl.imagePath + "/" + channelName + rl.audioExtension))
+    {
+        return {};
+    }
+    return { rl.imagePath + "/" + rl.imageFiles[index] };
+}
+
+static std::string getTextureArraySlotFile(const uint32_t slot)
+{
+    ResourceList& rl = ResourceList::getInstance();
+    return rl.imagePath + "/" + rl.imageArrayName + std::to_string(slot) + ".png";
+}
+
+// Shader define of the channel files before the image is loaded.
+static std::string getChannelFileShaderDefine(const uint32_t index)
+{
+    ResourceList& rl = ResourceList::getInstance();
+    if (!getSequenceFrameFiles(rl.imageFilesForSearch[index]).empty())
+    {
+        return "";
+    }
+    VkImageViewType viewType = VK_IMAGE_VIEW_TYPE_2D;
+    getChannelImageFiles(index, viewType);
+    return getChannelShaderDefine(index, viewType);
+}
+
+// Sets the sampler state field named by the word, false if the word is not known.
+static bool parseSamplerWord(const std::string& word, SamplerState& state)
+{
+    static const std::pair<const char*, VkFilter> c_filters[] =
+    {
+        { "nearest", VK_FILTER_NEAREST },
+        { "linear",  VK_FILTER_LINEAR },
+    };
+    static const std::pair<const char*, VkSamplerAddressMode> c_addressModes[] =
+    {
+        { "repeat", VK_SAMPLER_ADDRESS_MODE_REPEAT },
+        { "mirror", VK_SAMPLER_ADDRESS_MODE_MIRRORED_REPEAT },
+        { "clamp",  VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE },
+        { "border", VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER },
+    };
+    static const std::pair<const char*, VkSamplerMipmapMode> c_mipmapModes[] =
+    {
+        { "mip_nearest", VK_SAMPLER_MIPMAP_MODE_NEAREST },
+        { "mip_linear",  VK_SAMPLER_MIPMAP_MODE_LINEAR },
+    };
+    for (const auto& filterRef : c_filters)
+    {
+        if (word == filterRef.first)
+        {
+            state.filter = filterRef.second;
+            return true;
+        }
+    }
+    for (const auto& addressModeRef : c_addressModes)
+    {
+        if (word == addressModeRef.first)
+        {
+            state.addressMode = addressModeRef.second;
+            return true;
+        }
+    }
+    for (const auto& mipmapModeRef : c_mipmapModes)
+    {
+        if (word == mipmapModeRef.first)
+        {
+            state.mipmapMode = mipmapModeRef.second;
+            return true;
+        }
+    }
+    // max anisotropy, e.g. 16
+    std::istringstream anisotropyStream(word);
+    return (anisotropyStream >> state.maxAnisotropy) && anisotropyStream.eof();
+}
+
+// Shader defines of the optional renderer modes.
+static std::string getModeShaderDefines()
+{
+    GlobalVariables& gv = GlobalVariables::getInstance();
+    std::string defines;
+    if (gv.specializeConstantInputs)
+    {
+        defines += "#define DEF_SPECIALIZE_INPUTS 1\n";
+    }
+    if (gv.pushConstantInputs)
+    {
+        defines += "#define DEF_PUSH_CONSTANT_INPUTS 1\n";
+    }
+    return defines;
+}
+
+static std::string getChannelFileShaderDefines()
+{
+    ResourceList& rl = ResourceList::getInstance();
+    std::string defines;
+    for (uint32_t idx = 0; idx < rl.imageFiles.size(); ++idx)
+    {
+        defines += getChannelFileShaderDefine(idx);
+    }
+    return defines;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void RendererStartup::compileShaders(JobSystem* const p_jobSystem)
+{
+    ResourceList& rl = ResourceList::getInstance();
+    assert(rl.shaderFiles.size() >= 2);
+
+    // the sampler types follow the channel files found before the images are loaded
+    shaderDefines = getModeShaderDefines() + getChannelFileShaderDefines();
+
+    ShaderFiles shaderFiles;
+    shaderFiles.vertShader = rl.shaderPath + "/" + rl.shaderFiles[0];
+    shaderFiles.fragShader = rl.shaderPath + "/" + rl.shaderFiles[1];
+    shaderFiles.shaderFileTypes = ShaderFiles::ShaderFileTypes::glsl;
+    shaderFiles.defines = shaderDefines;
+    shaderFiles.optimization = GlobalVariables::getInstance().shaderOptimization;
+    shaderCode = Shader::compileGlsl(shaderFiles, p_jobSystem);
+}
+
+void RendererStartup::loadPipelineCache()
+{
+    ResourceList& rl = ResourceList::getInstance();
+    std::ifstream file(rl.pipelineCacheFile, std::ios::in | std::ios::binary);
+    if (file.is_open())
+    {
+        pipelineCacheData.assign(
+            std::istreambuf_iterator<char>(file),
+            std::istreambuf_iterator<char>());
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Renderer::Renderer(GfxResources* const p_gfxResources,
+    Window* const p_window,
+    JobSystem* const p_jobSystem,
+    const RendererStartup& startup)
     : mp_gfxResources(p_gfxResources),
     mp_gfxDevice(p_gfxResources->getDevice()),
-    mp_window(p_window)
+    mp_window(p_window),
+    mp_jobSystem(p_jobSystem)
 {
     assert(mp_gfxResources);
     assert(mp_gfxDevice);
     assert(mp_window);
+    assert(mp_jobSystem);
 
-    createImages();
-    createShaders(false);
+    createDrawCmdPools();
+
+    // only the channels which the shader samples are loaded
+    m_samplerCache.reset(new SamplerCache(mp_gfxDevice));
+    loadSamplerStates();
+    createImageSet();
+    createPlaceholderImage();
+    createShaders(startup);
+
+    // the channels the shader samples are decoded straight to staging buffers
+    // while the objects not depending on them are created
+    std::vector<std::unique_ptr<ImageUpload> > uploads = beginImages();
 
-    createDescriptorsImage();
-    createDescriptorsUniform();
     createRenderPasses();
     createFramebuffers();
+    createPipelineCache(startup.pipelineCacheData);
+
+    for (auto&& uploadRef : uploads)
+    {
+        endImageUpload(*uploadRef);
+    }
+    m_imageSet.dirty = true;
+
+    // descriptor layouts are reflected from the shader
+    loadParams();
+    loadPresets();
+    createDescriptorsUniform();
+    updateChannelUniforms();
+    updateParamUniforms();
+    createDescriptorsImage();
     createGraphicsPipeline();
 }
 
@@ -52,6 +397,9 @@ Renderer::~Renderer()
     {
         mp_gfxResources->waitForIdle();
 
+        // a background rebuild uses the render pass
+        destroyGraphicsPipeline();
+
         for (uint32_t idx = 0; idx < m_framebuffers.size(); ++idx)
         {
             vkDestroyFramebuffer(mp_gfxDevice->logicalDevice,
@@ -60,8 +408,14 @@ Renderer::~Renderer()
 
         vkDestroyRenderPass(mp_gfxDevice->logicalDevice, m_renderPass, nullptr);
 
-        vkDestroyPipelineLayout(mp_gfxDevice->logicalDevice, m_pipelineLayout, nullptr);
-        vkDestroyPipeline(mp_gfxDevice->logicalDevice, m_graphicsPipeline, nullptr);
+        savePipelineCache();
+        vkDestroyPipelineCache(mp_gfxDevice->logicalDevice, m_pipelineCache, nullptr);
+
+        // frees the draw command buffers
+        for (uint32_t idx = 0; idx < m_drawCmdPools.size(); ++idx)
+        {
+            vkDestroyCommandPool(mp_gfxDevice->logicalDevice, m_drawCmdPools[idx], nullptr);
+        }
     }
 }
 
@@ -70,8 +424,6 @@ void Renderer::render(const RendererInput& rendererInput)
     VkDevice logicalDevice = mp_gfxDevice->logicalDevice;
     GfxSwapchain* const p_gfxSwapchain = mp_gfxResources->getSwapchain();
     VkSwapchainKHR swapchain = p_gfxSwapchain->swapchain;
-    VkRenderPass renderPass = m_renderPass;
-    VkPipeline graphicsPipeline = m_graphicsPipeline;
     VkQueue queue = mp_gfxResources->getQueue()->queue;
 
     GfxCmdBuffer::CmdBuffer cmdBuffer = mp_gfxResources->getCmdBuffer()->getNextCmdBuffer();
@@ -91,7 +443,9 @@ void Renderer::render(const RendererInput& rendererInput)
     }
 
     const uint32_t currImageIndex = p_gfxSwapchain->imageIndex;
-    VkFramebuffer framebuffer = m_framebuffers[currImageIndex];
+
+    // transient data of the previous frame was only used for recording
+    m_frameArena.reset();
 
     // setup command buffer
     {
@@ -103,149 +457,92 @@ void Renderer::render(const RendererInput& rendererInput)
             VK_TRUE,            // waitAll
             timeout));          // timeout
 
-        CHECK_VK_RESULT_SUCCESS(vkResetCommandBuffer(
-            cmdBuffer.commandBuffer,    // commandBuffer
-            0));                        // flags
+        // stream staging buffers copied by this command buffer are free again
+        releaseStreamFrames(cmdBuffer.bufferIndex);
+        releaseRetiredChannels();
+        swapSpecializedPipeline();
+        updateUniformSlot(cmdBuffer.bufferIndex);
+        updateDescriptorSetImage(cmdBuffer.bufferIndex);
+    }
 
-        constexpr VkCommandBufferBeginInfo commandBufferBeginInfo =
-        {
-            VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,    // sType
-            nullptr,                                        // pNext
-            VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,    // flags
-            nullptr                                         // pInheritanceInfo
-        };
+    // push constant values are recorded into the command buffer,
+    // so the draw commands of such a shader are recorded every frame
+    const ShaderReflection& reflection = m_shader->reflection;
+    const bool preRecorded = reflection.pushConstantSize == 0;
 
-        CHECK_VK_RESULT_SUCCESS(vkBeginCommandBuffer(
-            cmdBuffer.commandBuffer,    // commandBuffer
-            &commandBufferBeginInfo));  // pBeginInfo
+    // with pre-recorded draw commands the frame command buffer is only recorded
+    // when there is something to copy
+    bool cmdBufferBegun = false;
+    if (!preRecorded)
+    {
+        beginCmdBuffer(cmdBuffer, cmdBufferBegun);
     }
 
     // copy image data
     if (m_imageSet.dirty)
     {
+        beginCmdBuffer(cmdBuffer, cmdBufferBegun);
         renderCopyImages(cmdBuffer); // using the same command buffer
     }
 
-    // setup descriptors
+    // copy new image sequence frames and audio analysis
+    renderCopyStreamFrames(cmdBuffer, rendererInput.globalTime, cmdBufferBegun);
+
+    // per-frame shader inputs at the reflected offsets of the push constant or frame input block
+    const uint32_t inputByteSize = !preRecorded ? reflection.pushConstantSize :
+        (m_gpuBufferFrame ? m_gpuBufferFrame->byteSize : 0);
+    uint8_t* const p_inputData = m_frameArena.allocate<uint8_t>(inputByteSize);
     {
-        std::vector<VkDescriptorSet> descriptorSets
-        { m_descriptorSetUniform->descriptorSet,
-        m_descriptorSetImage->descriptorSet };
+        const float width = (float)mp_gfxResources->getSwapchain()->extent.width;
+        const float height = (float)mp_gfxResources->getSwapchain()->extent.height;
+        const float mouse[4] =
+        { (float)rendererInput.mousePos.leftPosX,
+            (float)rendererInput.mousePos.leftPosY,
+            (float)rendererInput.mousePos.clickLeft,
+            (float)rendererInput.mousePos.clickLeft };
+        const float resolution[4] = { width, height, width / height, 0.0f };
+        const float channelTime[4] =
+        { rendererInput.globalTime, rendererInput.globalTime,
+            rendererInput.globalTime, rendererInput.globalTime };
+
+        const float globalVariables[4] =
+        { rendererInput.deltaTime, (float)rendererInput.frameIndex,
+            rendererInput.globalTime, getSampleRate() };
+
+        writeShaderInput(p_inputData, m_shaderInputs.iMouse, mouse);
+        writeShaderInput(p_inputData, m_shaderInputs.iDate, rendererInput.date);
+        writeShaderInput(p_inputData, m_shaderInputs.iResolution, resolution);
+        writeShaderInput(p_inputData, m_shaderInputs.iChannelTime, channelTime);
+        writeShaderInput(p_inputData, m_shaderInputs.globalVariables, globalVariables);
+    }
 
-        ShaderInputUniform shaderInputUniform;
-        for (uint32_t idx = 0; idx < 4; ++idx)
+    // frame command buffer (copies) is submitted before the draw commands
+    VkCommandBuffer submitCmdBuffers[2] = { nullptr, nullptr };
+    uint32_t submitCmdBufferCount = 0;
+    if (preRecorded)
+    {
+        // the slot follows the command buffer, its fence was waited above
+        if (m_gpuBufferFrame)
         {
-            shaderInputUniform.iChannelResolution[idx][0] = (float)m_imageSet.images[idx]->size.width;
-            shaderInputUniform.iChannelResolution[idx][1] = (float)m_imageSet.images[idx]->size.height;
-            shaderInputUniform.iChannelResolution[idx][2] = (float)m_imageSet.images[idx]->size.depth;
-            shaderInputUniform.iChannelResolution[idx][3] = 0.0f;
+            m_gpuBufferFrame->copyData(cmdBuffer.bufferIndex, inputByteSize, p_inputData);
         }
-        for (uint32_t idx = 0; idx < 4; ++idx)
+        if (m_drawCmdBuffersDirty[cmdBuffer.bufferIndex])
         {
-            shaderInputUniform.iDate[idx] = rendererInput.date[idx];
-            shaderInputUniform.iChannelTime[idx] = rendererInput.globalTime;
+            recordDrawCmdBuffers(cmdBuffer.bufferIndex);
         }
-        shaderInputUniform.iMouse[0] = (float)rendererInput.mousePos.leftPosX;
-        shaderInputUniform.iMouse[1] = (float)rendererInput.mousePos.leftPosY;
-        shaderInputUniform.iMouse[2] = (float)rendererInput.mousePos.clickLeft;
-        shaderInputUniform.iMouse[3] = (float)rendererInput.mousePos.clickLeft;
-        shaderInputUniform.iResolution[0] = (float)mp_window->getWidth();
-        shaderInputUniform.iResolution[1] = (float)mp_window->getHeight();
-        shaderInputUniform.iResolution[2] = shaderInputUniform.iResolution[0] / shaderInputUniform.iResolution[1];
-        shaderInputUniform.iResolution[3] = 0.0f;
-        shaderInputUniform.iGlobalDelta = rendererInput.deltaTime;
-        shaderInputUniform.iGlobalFrame = (float)rendererInput.frameIndex;
-        shaderInputUniform.iSampleRate = 44100.0f; // don't know about this
-        shaderInputUniform.iGlobalTime = rendererInput.globalTime;
-
-        const VkDeviceSize bufByteSize = m_gpuBufferUniform->byteSize;
-        m_gpuBufferUniform->copyData((uint32_t)bufByteSize, (uint8_t*)&shaderInputUniform);
-
-        VkBuffer buffer = m_gpuBufferUniform->buffer;
-        const VkDeviceSize bufByteOffset = m_gpuBufferUniform->getByteOffset();
-        VkPipelineLayout pipelineLayout = m_pipelineLayout;
-        
-        const VkBufferMemoryBarrier bufferMemoryBarrier =
+        if (cmdBufferBegun)
         {
-            VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,    // sType
-            nullptr,                                    // pNext
-            VK_ACCESS_HOST_WRITE_BIT,                   // srcAccessMask
-            VK_ACCESS_UNIFORM_READ_BIT,                 // dstAccessMask
-            VK_QUEUE_FAMILY_IGNORED,                    // srcQueueFamilyIndex
-            VK_QUEUE_FAMILY_IGNORED,                    // dstQueueFamilyIndex
-            buffer,                                     // buffer
-            bufByteOffset,                              // offset
-            bufByteSize                                 // size
-        };
-
-        vkCmdPipelineBarrier(
-            cmdBuffer.commandBuffer,            // commandBuffer
-            VK_PIPELINE_STAGE_HOST_BIT,         // srcStageMask
-            VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,// dstStageMask
-            0,                                  // dependencyFlags
-            0,                                  // memoryBarrierCount
-            nullptr,                            // pMemoryBarriers
-            1,                                  // bufferMemoryBarrierCount
-            &bufferMemoryBarrier,               // pBufferMemoryBarriers,
-            0,                                  // imageMemoryBarrierCount
-            nullptr);                           // pImageMemoryBarriers
-
-        const uint32_t dynamicOffset = (uint32_t)bufByteOffset;
-        vkCmdBindDescriptorSets(
-            cmdBuffer.commandBuffer,            // commandBuffer
-            VK_PIPELINE_BIND_POINT_GRAPHICS,    // pipelineBindPoint
-            pipelineLayout,                     // layout
-            0,                                  // firstSet
-            (uint32_t)descriptorSets.size(),    // descriptorSetCount
-            descriptorSets.data(),              // pDescriptorSets
-            1,                                  // dynamicOffsetCount
-            &dynamicOffset);                    // pDynamicOffsets
-    }
-
-    const uint32_t width = mp_window->getWidth();
-    const uint32_t height = mp_window->getHeight();
-
-    const VkRect2D renderArea =
-    {
-        { 0, 0 },           // offset
-        { width, height}    // extent
-    };
-    constexpr VkClearValue clearValue =
-    {
-        { 0.0f, 0.0f, 0.0f, 0.0f }, // color
-    };
-
-    const VkRenderPassBeginInfo renderPassBeginInfo =
+            CHECK_VK_RESULT_SUCCESS(vkEndCommandBuffer(cmdBuffer.commandBuffer));
+            submitCmdBuffers[submitCmdBufferCount++] = cmdBuffer.commandBuffer;
+        }
+        submitCmdBuffers[submitCmdBufferCount++] = m_drawCmdBuffers[cmdBuffer.bufferIndex][currImageIndex];
+    }
+    else
     {
-        VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,   // sType
-        nullptr,                                    // pNext
-        renderPass,                                 // renderPass
-        framebuffer,                                // framebuffer
-        renderArea,                                 // renderArea
-        1,                                          // clearValueCount
-        &clearValue                                 // pClearValues;
-    };
-
-    vkCmdBeginRenderPass(
-        cmdBuffer.commandBuffer,        // commandBuffer
-        &renderPassBeginInfo,           // pRenderPassBegin
-        VK_SUBPASS_CONTENTS_INLINE);    // contents
-
-    vkCmdBindPipeline(
-        cmdBuffer.commandBuffer,            // commandBuffer
-        VK_PIPELINE_BIND_POINT_GRAPHICS,    // pipelineBindPoint
-        graphicsPipeline);                  // pipeline
-
-    vkCmdDraw(
-        cmdBuffer.commandBuffer,    // commandBuffer
-        3,                          // vertexCount
-        1,                          // instanceCount
-        0,                          // firstVertex
-        0);                         // firstInstance
-
-    vkCmdEndRenderPass(cmdBuffer.commandBuffer);
-
-    CHECK_VK_RESULT_SUCCESS(vkEndCommandBuffer(cmdBuffer.commandBuffer));
+        recordDrawCommands(cmdBuffer.commandBuffer, currImageIndex, cmdBuffer.bufferIndex, p_inputData);
+        CHECK_VK_RESULT_SUCCESS(vkEndCommandBuffer(cmdBuffer.commandBuffer));
+        submitCmdBuffers[submitCmdBufferCount++] = cmdBuffer.commandBuffer;
+    }
 
     // submit
     {
@@ -266,8 +563,8 @@ void Renderer::render(const RendererInput& rendererInput)
             1,                              // waitSemaphoreCount
             &swapchainImageSemaphore,       // pWaitSemaphores
             &waitStageFlags,                // pWaitDstStageMask
-            1,                              // commandBufferCount
-            &cmdBuffer.commandBuffer,       // pCommandBuffers
+            submitCmdBufferCount,           // commandBufferCount
+            submitCmdBuffers,               // pCommandBuffers
             1,                              // signalSemaphoreCount
             &cmdBuffer.submitSemaphore      // pSignalSemaphores
         };
@@ -299,82 +596,335 @@ void Renderer::render(const RendererInput& rendererInput)
     }
 }
 
-void Renderer::renderCopyImages(GfxCmdBuffer::CmdBuffer& cmdBuffer)
+void Renderer::beginCmdBuffer(GfxCmdBuffer::CmdBuffer& cmdBuffer, bool& begun)
 {
-    // create barriers
-    std::vector<VkImageMemoryBarrier> preImageMemoryBarriers;
-    std::vector<VkImageMemoryBarrier> postImageMemoryBarriers;
-    for (uint32_t idx = 0; idx < m_imageSet.dirtyFlags.size(); ++idx)
+    if (begun)
     {
-        if (m_imageSet.dirtyFlags[idx])
-        {
-            const VkImageSubresourceRange imageSubresourceRange =
-            {
-                VK_IMAGE_ASPECT_COLOR_BIT,  // aspectMask
-                0,                          // baseMipLevel
-                1,                          // levelCount
-                0,                          // baseArrayLayer
-                1,                          // layerCount
-            };
-            const VkImageMemoryBarrier imageMemoryBarrierPre =
-            {
-                VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER, // sType
-                nullptr,                                // pNext
-                0,                                      // srcAccessMask
-                VK_ACCESS_TRANSFER_WRITE_BIT,           // dstAccessMask
-                VK_IMAGE_LAYOUT_UNDEFINED,              // oldLayout
-                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,   // newLayout
-                VK_QUEUE_FAMILY_IGNORED,                // srcQueueFamilyIndex
-                VK_QUEUE_FAMILY_IGNORED,                // dstQueueFamilyIndex
-                m_imageSet.images[idx]->image,          // image
-                imageSubresourceRange                   // subresourceRange
-            };
-            preImageMemoryBarriers.emplace_back(std::move(imageMemoryBarrierPre));
+        return;
+    }
+    begun = true;
 
-            const VkImageMemoryBarrier imageMemoryBarrierPost =
-            {
-                VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,     // sType
-                nullptr,                                    // pNext
-                VK_ACCESS_TRANSFER_WRITE_BIT,               // srcAccessMask
-                VK_ACCESS_SHADER_READ_BIT,                  // dstAccessMask
-                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,       // oldLayout
-                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,   // newLayout
-                VK_QUEUE_FAMILY_IGNORED,                    // srcQueueFamilyIndex
-                VK_QUEUE_FAMILY_IGNORED,                    // dstQueueFamilyIndex
-                m_imageSet.images[idx]->image,              // image
-                imageSubresourceRange                       // subresourceRange
-            };
-            postImageMemoryBarriers.emplace_back(std::move(imageMemoryBarrierPost));
-        }
+    CHECK_VK_RESULT_SUCCESS(vkResetCommandBuffer(
+        cmdBuffer.commandBuffer,    // commandBuffer
+        0));                        // flags
+
+    constexpr VkCommandBufferBeginInfo commandBufferBeginInfo =
+    {
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,    // sType
+        nullptr,                                        // pNext
+        VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,    // flags
+        nullptr                                         // pInheritanceInfo
+    };
+
+    CHECK_VK_RESULT_SUCCESS(vkBeginCommandBuffer(
+        cmdBuffer.commandBuffer,    // commandBuffer
+        &commandBufferBeginInfo));  // pBeginInfo
+}
+
+void Renderer::recordDrawCommands(VkCommandBuffer commandBuffer,
+    const uint32_t imageIndex,
+    const uint32_t cmdBufferIndex,
+    const uint8_t* const p_pushConstantData)
+{
+    const VkDescriptorSet descriptorSets[] =
+    { m_descriptorSetsUniform[cmdBufferIndex]->descriptorSet,
+    m_descriptorSetsImage[cmdBufferIndex]->descriptorSet };
+
+    vkCmdBindDescriptorSets(
+        commandBuffer,                      // commandBuffer
+        VK_PIPELINE_BIND_POINT_GRAPHICS,    // pipelineBindPoint
+        m_pipelineLayout,                   // layout
+        0,                                  // firstSet
+        2,                                  // descriptorSetCount
+        descriptorSets,                     // pDescriptorSets
+        0,                                  // dynamicOffsetCount
+        nullptr);                           // pDynamicOffsets
+
+    const ShaderReflection& reflection = m_shader->reflection;
+    if (reflection.pushConstantSize > 0)
+    {
+        vkCmdPushConstants(
+            commandBuffer,                          // commandBuffer
+            m_pipelineLayout,                       // layout
+            reflection.pushConstantStageFlags,      // stageFlags
+            0,                                      // offset
+            reflection.pushConstantSize,            // size
+            p_pushConstantData);                    // pValues
     }
 
-    vkCmdPipelineBarrier(
-        cmdBuffer.commandBuffer,                    // commandBuffer
-        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,          // srcStageMask
-        VK_PIPELINE_STAGE_TRANSFER_BIT,             // dstStageMask
-        VK_DEPENDENCY_BY_REGION_BIT,                // dependencyFlags
-        0,                                          // memoryBarrierCount
-        nullptr,                                    // pMemoryBarriers
-        0,                                          // bufferMemoryBarrierCount
-        nullptr,                                    // pBufferMemoryBarriers
-        (uint32_t)preImageMemoryBarriers.size(),    // imageMemoryBarrierCount
-        preImageMemoryBarriers.data()               // pImageMemoryBarriers
-    );
+    const uint32_t width = mp_gfxResources->getSwapchain()->extent.width;
+    const uint32_t height = mp_gfxResources->getSwapchain()->extent.height;
 
-    // copy from staging buffers to gpu images
-    for (uint32_t idx = 0; idx < m_imageSet.dirtyFlags.size(); ++idx)
+    const VkRect2D renderArea =
     {
-        if (m_imageSet.dirtyFlags[idx])
-        {
-            const VkExtent3D imageExtend = m_imageSet.images[idx]->size;
-            const uint32_t bufferRowLength = imageExtend.width;
-            const uint32_t bufferRowHeight = imageExtend.height;
+        { 0, 0 },           // offset
+        { width, height}    // extent
+    };
+    constexpr VkClearValue clearValue =
+    {
+        { 0.0f, 0.0f, 0.0f, 0.0f }, // color
+    };
+
+    const VkRenderPassBeginInfo renderPassBeginInfo =
+    {
+        VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,   // sType
+        nullptr,                                    // pNext
+        m_renderPass,                               // renderPass
+        m_framebuffers[imageIndex],                 // framebuffer
+        renderArea,                                 // renderArea
+        1,                                          // clearValueCount
+        &clearValue                                 // pClearValues;
+    };
+
+    vkCmdBeginRenderPass(
+        commandBuffer,                  // commandBuffer
+        &renderPassBeginInfo,           // pRenderPassBegin
+        VK_SUBPASS_CONTENTS_INLINE);    // contents
+
+    vkCmdBindPipeline(
+        commandBuffer,                      // commandBuffer
+        VK_PIPELINE_BIND_POINT_GRAPHICS,    // pipelineBindPoint
+        m_graphicsPipeline);                // pipeline
+
+    vkCmdDraw(
+        commandBuffer,  // commandBuffer
+        3,              // vertexCount
+        1,              // instanceCount
+        0,              // firstVertex
+        0);             // firstInstance
+
+    vkCmdEndRenderPass(commandBuffer);
+}
+
+void Renderer::recordDrawCmdBuffers(const uint32_t cmdBufferIndex)
+{
+    // the fence of the command buffer was waited, none of the draw command buffers of its slot are pending
+    CHECK_VK_RESULT_SUCCESS(vkResetCommandPool(
+        mp_gfxDevice->logicalDevice,        // device
+        m_drawCmdPools[cmdBufferIndex],     // commandPool
+        0));                                // flags
+
+    // submitted again every time their swapchain image and slot come around
+    constexpr VkCommandBufferBeginInfo commandBufferBeginInfo =
+    {
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,    // sType
+        nullptr,                                        // pNext
+        0,                                              // flags
+        nullptr                                         // pInheritanceInfo
+    };
+
+    const std::vector<VkCommandBuffer>& drawCmdBuffers = m_drawCmdBuffers[cmdBufferIndex];
+    for (uint32_t imageIdx = 0; imageIdx < drawCmdBuffers.size(); ++imageIdx)
+    {
+        CHECK_VK_RESULT_SUCCESS(vkBeginCommandBuffer(
+            drawCmdBuffers[imageIdx],   // commandBuffer
+            &commandBufferBeginInfo));  // pBeginInfo
+
+        recordDrawCommands(drawCmdBuffers[imageIdx], imageIdx, cmdBufferIndex, nullptr);
+
+        CHECK_VK_RESULT_SUCCESS(vkEndCommandBuffer(drawCmdBuffers[imageIdx]));
+    }
+    m_drawCmdBuffersDirty[cmdBufferIndex] = false;
+}
+
+void Renderer::invalidateDrawCmdBuffers()
+{
+    m_drawCmdBuffersDirty.assign(m_drawCmdBuffersDirty.size(), true);
+}
+
+void Renderer::createDrawCmdPools()
+{
+    // one pool per command buffer of the ring, reset when the slot is re-recorded
+    const uint32_t slotCount = (uint32_t)mp_gfxResources->getCmdBuffer()->commandBuffers.size();
+    m_drawCmdPools.resize(slotCount);
+    m_drawCmdBuffers.resize(slotCount);
+    m_drawCmdBuffersDirty.assign(slotCount, true);
+    for (uint32_t idx = 0; idx < slotCount; ++idx)
+    {
+        const VkCommandPoolCreateInfo commandPoolCreateInfo =
+        {
+            VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,         // sType
+            nullptr,                                            // pNext
+            0,                                                  // flags
+            mp_gfxResources->getQueue()->queueFamilyIndex       // queueFamilyIndex
+        };
+
+        CHECK_VK_RESULT_SUCCESS(vkCreateCommandPool(
+            mp_gfxDevice->logicalDevice,    // device
+            &commandPoolCreateInfo,         // pCreateInfo
+            nullptr,                        // pAllocator
+            &m_drawCmdPools[idx]));         // pCommandPool
+    }
+}
+
+void Renderer::allocateDrawCmdBuffers()
+{
+    // one per swapchain image and slot, only called after waiting for idle
+    const uint32_t imageCount = (uint32_t)m_framebuffers.size();
+    for (uint32_t idx = 0; idx < m_drawCmdPools.size(); ++idx)
+    {
+        std::vector<VkCommandBuffer>& drawCmdBuffersRef = m_drawCmdBuffers[idx];
+        if (drawCmdBuffersRef.size() == imageCount)
+        {
+            continue;
+        }
+        if (!drawCmdBuffersRef.empty())
+        {
+            vkFreeCommandBuffers(
+                mp_gfxDevice->logicalDevice,            // device
+                m_drawCmdPools[idx],                    // commandPool
+                (uint32_t)drawCmdBuffersRef.size(),     // commandBufferCount
+                drawCmdBuffersRef.data());              // pCommandBuffers
+        }
+        drawCmdBuffersRef.resize(imageCount);
+
+        const VkCommandBufferAllocateInfo commandBufferAllocateInfo =
+        {
+            VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO, // sType
+            nullptr,                                        // pNext
+            m_drawCmdPools[idx],                            // commandPool
+            VK_COMMAND_BUFFER_LEVEL_PRIMARY,                // level
+            imageCount                                      // commandBufferCount
+        };
+
+        CHECK_VK_RESULT_SUCCESS(vkAllocateCommandBuffers(
+            mp_gfxDevice->logicalDevice,    // device
+            &commandBufferAllocateInfo,     // pAllocateInfo
+            drawCmdBuffersRef.data()));     // pCommandBuffers
+    }
+    invalidateDrawCmdBuffers();
+}
+
+void Renderer::renderCopyImages(GfxCmdBuffer::CmdBuffer& cmdBuffer)
+{
+    // create barriers
+    const uint32_t dirtyCount = (uint32_t)std::count(
+        m_imageSet.dirtyFlags.begin(), m_imageSet.dirtyFlags.end(), true);
+    // images nothing holds anymore (replaced before the first frame) are not cleared
+    m_imageSet.clears.erase(std::remove_if(m_imageSet.clears.begin(), m_imageSet.clears.end(),
+        [](const std::shared_ptr<GpuImage>& image) { return image.use_count() == 1; }),
+        m_imageSet.clears.end());
+    const uint32_t clearCount = (uint32_t)m_imageSet.clears.size();
+    VkImageMemoryBarrier* const preImageMemoryBarriers =
+        m_frameArena.allocate<VkImageMemoryBarrier>(dirtyCount + clearCount);
+    VkImageMemoryBarrier* const postImageMemoryBarriers =
+        m_frameArena.allocate<VkImageMemoryBarrier>(dirtyCount + clearCount);
+    uint32_t barrierCount = 0;
+    for (uint32_t idx = 0; idx < m_imageSet.dirtyFlags.size(); ++idx)
+    {
+        if (m_imageSet.dirtyFlags[idx])
+        {
+            const VkImageSubresourceRange imageSubresourceRange =
+            {
+                VK_IMAGE_ASPECT_COLOR_BIT,          // aspectMask
+                0,                                  // baseMipLevel
+                1,                                  // levelCount
+                0,                                  // baseArrayLayer
+                m_imageSet.images[idx]->layerCount, // layerCount
+            };
+            const VkImageMemoryBarrier imageMemoryBarrierPre =
+            {
+                VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER, // sType
+                nullptr,                                // pNext
+                0,                                      // srcAccessMask
+                VK_ACCESS_TRANSFER_WRITE_BIT,           // dstAccessMask
+                VK_IMAGE_LAYOUT_UNDEFINED,              // oldLayout
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,   // newLayout
+                VK_QUEUE_FAMILY_IGNORED,                // srcQueueFamilyIndex
+                VK_QUEUE_FAMILY_IGNORED,                // dstQueueFamilyIndex
+                m_imageSet.images[idx]->image,          // image
+                imageSubresourceRange                   // subresourceRange
+            };
+            preImageMemoryBarriers[barrierCount] = imageMemoryBarrierPre;
+
+            const VkImageMemoryBarrier imageMemoryBarrierPost =
+            {
+                VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,     // sType
+                nullptr,                                    // pNext
+                VK_ACCESS_TRANSFER_WRITE_BIT,               // srcAccessMask
+                VK_ACCESS_SHADER_READ_BIT,                  // dstAccessMask
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,       // oldLayout
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,   // newLayout
+                VK_QUEUE_FAMILY_IGNORED,                    // srcQueueFamilyIndex
+                VK_QUEUE_FAMILY_IGNORED,                    // dstQueueFamilyIndex
+                m_imageSet.images[idx]->image,              // image
+                imageSubresourceRange                       // subresourceRange
+            };
+            postImageMemoryBarriers[barrierCount] = imageMemoryBarrierPost;
+            ++barrierCount;
+        }
+    }
+    // images without data, only cleared
+    for (const auto& imageRef : m_imageSet.clears)
+    {
+        const VkImageSubresourceRange imageSubresourceRange =
+        {
+            VK_IMAGE_ASPECT_COLOR_BIT,  // aspectMask
+            0,                          // baseMipLevel
+            1,                          // levelCount
+            0,                          // baseArrayLayer
+            imageRef->layerCount,       // layerCount
+        };
+        const VkImageMemoryBarrier imageMemoryBarrierPre =
+        {
+            VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER, // sType
+            nullptr,                                // pNext
+            0,                                      // srcAccessMask
+            VK_ACCESS_TRANSFER_WRITE_BIT,           // dstAccessMask
+            VK_IMAGE_LAYOUT_UNDEFINED,              // oldLayout
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,   // newLayout
+            VK_QUEUE_FAMILY_IGNORED,                // srcQueueFamilyIndex
+            VK_QUEUE_FAMILY_IGNORED,                // dstQueueFamilyIndex
+            imageRef->image,                        // image
+            imageSubresourceRange                   // subresourceRange
+        };
+        preImageMemoryBarriers[barrierCount] = imageMemoryBarrierPre;
+
+        const VkImageMemoryBarrier imageMemoryBarrierPost =
+        {
+            VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,     // sType
+            nullptr,                                    // pNext
+            VK_ACCESS_TRANSFER_WRITE_BIT,               // srcAccessMask
+            VK_ACCESS_SHADER_READ_BIT,                  // dstAccessMask
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,       // oldLayout
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,   // newLayout
+            VK_QUEUE_FAMILY_IGNORED,                    // srcQueueFamilyIndex
+            VK_QUEUE_FAMILY_IGNORED,                    // dstQueueFamilyIndex
+            imageRef->image,                            // image
+            imageSubresourceRange                       // subresourceRange
+        };
+        postImageMemoryBarriers[barrierCount] = imageMemoryBarrierPost;
+        ++barrierCount;
+    }
+
+    vkCmdPipelineBarrier(
+        cmdBuffer.commandBuffer,                    // commandBuffer
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,          // srcStageMask
+        VK_PIPELINE_STAGE_TRANSFER_BIT,             // dstStageMask
+        VK_DEPENDENCY_BY_REGION_BIT,                // dependencyFlags
+        0,                                          // memoryBarrierCount
+        nullptr,                                    // pMemoryBarriers
+        0,                                          // bufferMemoryBarrierCount
+        nullptr,                                    // pBufferMemoryBarriers
+        barrierCount,                               // imageMemoryBarrierCount
+        preImageMemoryBarriers                      // pImageMemoryBarriers
+    );
+
+    // copy from staging buffers to gpu images
+    for (uint32_t idx = 0; idx < m_imageSet.dirtyFlags.size(); ++idx)
+    {
+        if (m_imageSet.dirtyFlags[idx])
+        {
+            const VkExtent3D imageExtend = m_imageSet.images[idx]->size;
+            const uint32_t bufferRowLength = imageExtend.width;
+            const uint32_t bufferRowHeight = imageExtend.height;
+            // cube faces are consecutive in the staging buffer
             const VkImageSubresourceLayers imageSubresourceLayers =
             {
-                VK_IMAGE_ASPECT_COLOR_BIT,  // aspectMask
-                0,                          // mipLevel
-                0,                          // baseArrayLayer
-                1,                          // layerCount
+                VK_IMAGE_ASPECT_COLOR_BIT,          // aspectMask
+                0,                                  // mipLevel
+                0,                                  // baseArrayLayer
+                m_imageSet.images[idx]->layerCount, // layerCount
             };
             const VkBufferImageCopy bufferImageCopy =
             {
@@ -395,6 +945,27 @@ void Renderer::renderCopyImages(GfxCmdBuffer::CmdBuffer& cmdBuffer)
         }
     }
 
+    // transparent black
+    const VkClearColorValue clearColor = {};
+    for (const auto& imageRef : m_imageSet.clears)
+    {
+        const VkImageSubresourceRange imageSubresourceRange =
+        {
+            VK_IMAGE_ASPECT_COLOR_BIT,  // aspectMask
+            0,                          // baseMipLevel
+            1,                          // levelCount
+            0,                          // baseArrayLayer
+            imageRef->layerCount,       // layerCount
+        };
+        vkCmdClearColorImage(
+            cmdBuffer.commandBuffer,                // commandBuffer
+            imageRef->image,                        // image
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,   // imageLayout
+            &clearColor,                            // pColor
+            1,                                      // rangeCount
+            &imageSubresourceRange);                // pRanges
+    }
+
     vkCmdPipelineBarrier(
         cmdBuffer.commandBuffer,                    // commandBuffer
         VK_PIPELINE_STAGE_TRANSFER_BIT,             // srcStageMask
@@ -404,138 +975,596 @@ void Renderer::renderCopyImages(GfxCmdBuffer::CmdBuffer& cmdBuffer)
         nullptr,                                    // pMemoryBarriers
         0,                                          // bufferMemoryBarrierCount
         nullptr,                                    // pBufferMemoryBarriers
-        (uint32_t)postImageMemoryBarriers.size(),   // imageMemoryBarrierCount
-        postImageMemoryBarriers.data()              // pImageMemoryBarriers
+        barrierCount,                               // imageMemoryBarrierCount
+        postImageMemoryBarriers                     // pImageMemoryBarriers
     );
 
     m_imageSet.dirty = false;
+    m_imageSet.clears.clear(); // keeps the capacity, no allocation next time
     for (auto&& flagsRef : m_imageSet.dirtyFlags)
     {
         flagsRef = false;
     }
 }
 
-void Renderer::createDescriptorsUniform()
+void Renderer::renderCopyStreamFrames(GfxCmdBuffer::CmdBuffer& cmdBuffer,
+    const float timeSeconds,
+    bool& cmdBufferBegun)
 {
-    const uint32_t bufferByteSize = sizeof(ShaderInputUniform);
+    for (uint32_t idx = 0; idx < m_imageSet.streams.size(); ++idx)
+    {
+        ImageStream* const p_stream = m_imageSet.streams[idx].get();
+        if (!p_stream)
+        {
+            continue;
+        }
+        // does not wait for the worker, the previous frame is shown if not ready
+        const int32_t slot = p_stream->acquireFrame(timeSeconds);
+        if (slot < 0)
+        {
+            continue;
+        }
+        m_imageSet.streamSlotsInFlight[cmdBuffer.bufferIndex].emplace_back(idx, slot);
+        beginCmdBuffer(cmdBuffer, cmdBufferBegun);
+
+        const GpuImage* const p_image = m_imageSet.images[idx].get();
+        const VkImageSubresourceRange imageSubresourceRange =
+        {
+            VK_IMAGE_ASPECT_COLOR_BIT,  // aspectMask
+            0,                          // baseMipLevel
+            1,                          // levelCount
+            0,                          // baseArrayLayer
+            1,                          // layerCount
+        };
 
-    m_descriptorSetUniform.reset(new DescriptorSet(
-        mp_gfxResources->getDevice(),
-        mp_gfxResources->getDescriptorPool()->uniforms,
-        1,
-        VkDescriptorType::VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
-        VK_SHADER_STAGE_FRAGMENT_BIT));
+        // the previous frames sampling needs to finish before overwriting
+        const VkImageMemoryBarrier imageMemoryBarrierPre =
+        {
+            VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER, // sType
+            nullptr,                                // pNext
+            0,                                      // srcAccessMask
+            VK_ACCESS_TRANSFER_WRITE_BIT,           // dstAccessMask
+            VK_IMAGE_LAYOUT_UNDEFINED,              // oldLayout
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,   // newLayout
+            VK_QUEUE_FAMILY_IGNORED,                // srcQueueFamilyIndex
+            VK_QUEUE_FAMILY_IGNORED,                // dstQueueFamilyIndex
+            p_image->image,                         // image
+            imageSubresourceRange                   // subresourceRange
+        };
 
-    m_gpuBufferUniform.reset(new GpuBufferUniform(mp_gfxDevice, bufferByteSize));
+        vkCmdPipelineBarrier(
+            cmdBuffer.commandBuffer,                // commandBuffer
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,  // srcStageMask
+            VK_PIPELINE_STAGE_TRANSFER_BIT,         // dstStageMask
+            0,                                      // dependencyFlags
+            0,                                      // memoryBarrierCount
+            nullptr,                                // pMemoryBarriers
+            0,                                      // bufferMemoryBarrierCount
+            nullptr,                                // pBufferMemoryBarriers
+            1,                                      // imageMemoryBarrierCount
+            &imageMemoryBarrierPre                  // pImageMemoryBarriers
+        );
+
+        const VkImageSubresourceLayers imageSubresourceLayers =
+        {
+            VK_IMAGE_ASPECT_COLOR_BIT,  // aspectMask
+            0,                          // mipLevel
+            0,                          // baseArrayLayer
+            1,                          // layerCount
+        };
+        const VkBufferImageCopy bufferImageCopy =
+        {
+            0,                      // bufferOffset
+            p_image->size.width,    // bufferRowLength
+            p_image->size.height,   // bufferImageHeight
+            imageSubresourceLayers, // imageSubresource
+            {0,0,0},                // imageOffset
+            p_image->size           // imageExtent
+        };
+        vkCmdCopyBufferToImage(
+            cmdBuffer.commandBuffer,                        // commandBuffer
+            p_stream->getStagingBuffer(slot)->buffer,       // srcBuffer
+            p_image->image,                                 // dstImage
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,           // dstImageLayout
+            1,                                              // regionCount
+            &bufferImageCopy);                              // pRegions
+
+        const VkImageMemoryBarrier imageMemoryBarrierPost =
+        {
+            VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,     // sType
+            nullptr,                                    // pNext
+            VK_ACCESS_TRANSFER_WRITE_BIT,               // srcAccessMask
+            VK_ACCESS_SHADER_READ_BIT,                  // dstAccessMask
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,       // oldLayout
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,   // newLayout
+            VK_QUEUE_FAMILY_IGNORED,                    // srcQueueFamilyIndex
+            VK_QUEUE_FAMILY_IGNORED,                    // dstQueueFamilyIndex
+            p_image->image,                             // image
+            imageSubresourceRange                       // subresourceRange
+        };
 
-    // update the descriptor set
+        vkCmdPipelineBarrier(
+            cmdBuffer.commandBuffer,                // commandBuffer
+            VK_PIPELINE_STAGE_TRANSFER_BIT,         // srcStageMask
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,  // dstStageMask
+            0,                                      // dependencyFlags
+            0,                                      // memoryBarrierCount
+            nullptr,                                // pMemoryBarriers
+            0,                                      // bufferMemoryBarrierCount
+            nullptr,                                // pBufferMemoryBarriers
+            1,                                      // imageMemoryBarrierCount
+            &imageMemoryBarrierPost                 // pImageMemoryBarriers
+        );
+    }
+}
 
-    const VkDescriptorBufferInfo descriptorBufferInfo =
+void Renderer::releaseStreamFrames(const uint32_t cmdBufferIndex)
+{
+    if (cmdBufferIndex >= m_imageSet.streamSlotsInFlight.size())
     {
-        m_gpuBufferUniform->buffer,     // buffer
-        0,                              // offset
-        m_gpuBufferUniform->byteSize    // range
-    };
-
-    const VkWriteDescriptorSet writeDescriptorSet =
+        return;
+    }
+    for (const auto& slotRef : m_imageSet.streamSlotsInFlight[cmdBufferIndex])
     {
-        VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,     // sType
-        nullptr,                                    // pNext
-        m_descriptorSetUniform->descriptorSet,      // dstSet
-        0,                                          // dstBinding
-        0,                                          // dstArrayElement
-        1,                                          // descriptorCount
-        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,  // descriptorType
-        nullptr,                                    // pImageInfo
-        &descriptorBufferInfo,                      // pBufferInfo
-        nullptr,                                    // pTexelBufferView
-    };
+        m_imageSet.streams[slotRef.first]->releaseFrame(slotRef.second);
+    }
+    m_imageSet.streamSlotsInFlight[cmdBufferIndex].clear();
+}
 
-    vkUpdateDescriptorSets(
-        mp_gfxDevice->logicalDevice,   // device
-        1,                          // descriptorWriteCount
-        &writeDescriptorSet,        // pDescriptorWrites
-        0,                          // descriptorCopyCount
-        nullptr);                   // pDescriptorCopies
+void Renderer::releaseRetiredChannels()
+{
+    // called after each fence wait, when all command buffers have been waited for
+    // the ones recorded before the retirement have finished
+    auto iter = m_imageSet.retired.begin();
+    while (iter != m_imageSet.retired.end())
+    {
+        if (--iter->frameCount == 0)
+        {
+            iter = m_imageSet.retired.erase(iter);
+        }
+        else
+        {
+            ++iter;
+        }
+    }
 }
 
-void Renderer::createDescriptorsImage()
+void Renderer::createDescriptorsUniform()
 {
-    const uint32_t imageCount = (uint32_t)m_imageSet.images.size();
+    const ShaderReflection& reflection = m_shader->reflection;
+    const uint32_t setCount = (uint32_t)mp_gfxResources->getCmdBuffer()->commandBuffers.size();
+    assert(setCount <= mp_gfxResources->getDescriptorPool()->c_maxSetsUniform);
+
+    m_descriptorSetsUniform.clear();
+    for (uint32_t idx = 0; idx < setCount; ++idx)
+    {
+        m_descriptorSetsUniform.emplace_back(new DescriptorSet(
+            mp_gfxResources->getDevice(),
+            mp_gfxResources->getDescriptorPool()->uniforms,
+            reflection.getSetLayoutBindings(0)));
+    }
+    m_uniformSlotDirty.assign(setCount, true);
+    invalidateDrawCmdBuffers();
+
+    // binding 0 is the channel uniform block, binding 1 the user parameter block
+    // and binding 2 the frame input block, the set of each command buffer points to
+    // its own slot of the buffers
+    std::unique_ptr<GpuBufferUniform>* const p_buffers[] =
+    { &m_gpuBufferUniform, &m_gpuBufferParams, &m_gpuBufferFrame };
+    const uint32_t bufferCount = (uint32_t)(sizeof(p_buffers) / sizeof(p_buffers[0]));
+    std::vector<VkDescriptorBufferInfo> descriptorBufferInfoArray;
+    descriptorBufferInfoArray.reserve(bufferCount * setCount);
+    std::vector<VkWriteDescriptorSet> writeDescriptorSetArray;
+    m_channelUniformData.clear();
+    m_paramUniformData.clear();
+    for (uint32_t idx = 0; idx < bufferCount; ++idx)
+    {
+        std::unique_ptr<GpuBufferUniform>& bufferRef = *p_buffers[idx];
+        const SpirvDescriptor* const p_block = reflection.findDescriptor(0, idx);
+        if (!p_block)
+        {
+            bufferRef.reset();
+            continue;
+        }
+        bufferRef.reset(new GpuBufferUniform(mp_gfxDevice, p_block->blockSize, setCount));
 
-    m_descriptorSetImage.reset();
-    m_descriptorSetImage.reset(new DescriptorSet(
-        mp_gfxResources->getDevice(),
-        mp_gfxResources->getDescriptorPool()->images,
-        imageCount,
-        VkDescriptorType::VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-        VK_SHADER_STAGE_FRAGMENT_BIT));
+        for (uint32_t setIdx = 0; setIdx < setCount; ++setIdx)
+        {
+            const VkDescriptorBufferInfo descriptorBufferInfo =
+            {
+                bufferRef->buffer,                      // buffer
+                bufferRef->getByteOffset(setIdx),       // offset
+                bufferRef->byteSize                     // range
+            };
+            descriptorBufferInfoArray.push_back(descriptorBufferInfo);
+
+            const VkWriteDescriptorSet writeDescriptorSet =
+            {
+                VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,             // sType
+                nullptr,                                            // pNext
+                m_descriptorSetsUniform[setIdx]->descriptorSet,     // dstSet
+                idx,                                                // dstBinding
+                0,                                                  // dstArrayElement
+                1,                                                  // descriptorCount
+                VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,                  // descriptorType
+                nullptr,                                            // pImageInfo
+                &descriptorBufferInfoArray.back(),                  // pBufferInfo
+                nullptr,                                            // pTexelBufferView
+            };
+            writeDescriptorSetArray.push_back(writeDescriptorSet);
+        }
+    }
 
-    std::vector<VkDescriptorImageInfo> descriptorImageInfoArray(imageCount);
-    for (uint32_t idx = 0; idx < descriptorImageInfoArray.size(); ++idx)
+    if (!writeDescriptorSetArray.empty())
     {
-        const VkDescriptorImageInfo descriptorImageInfo =
+        vkUpdateDescriptorSets(
+            mp_gfxDevice->logicalDevice,                // device
+            (uint32_t)writeDescriptorSetArray.size(),   // descriptorWriteCount
+            writeDescriptorSetArray.data(),             // pDescriptorWrites
+            0,                                          // descriptorCopyCount
+            nullptr);                                   // pDescriptorCopies
+    }
+}
+
+void Renderer::updateChannelUniforms()
+{
+    if (!m_gpuBufferUniform)
+    {
+        return;
+    }
+
+    std::vector<uint8_t> blockData(m_gpuBufferUniform->byteSize, 0);
+    const ShaderInputMember& member = m_shaderInputs.iChannelResolution;
+    for (uint32_t idx = 0; idx < 4; ++idx)
+    {
+        if (!isChannelLoaded(idx))
         {
-            m_imageSet.images[idx]->sampler,       // sampler
-            m_imageSet.images[idx]->imageView,     // imageView
-            m_imageSet.images[idx]->imageLayout    // imageLayout
-        };
-        descriptorImageInfoArray[idx] = descriptorImageInfo;
+            continue;
+        }
+        const float resolution[4] =
+        { (float)m_imageSet.images[idx]->size.width,
+            (float)m_imageSet.images[idx]->size.height,
+            (float)m_imageSet.images[idx]->size.depth,
+            0.0f };
+
+        // vec4 array, one element per channel
+        if (member.offset != ~0u && (idx + 1) * sizeof(resolution) <= member.size)
+        {
+            ShaderInputMember element;
+            element.offset = member.offset + idx * (uint32_t)sizeof(resolution);
+            element.size = (uint32_t)sizeof(resolution);
+            writeShaderInput(blockData.data(), element, resolution);
+        }
+    }
+    if (blockData == m_channelUniformData)
+    {
+        return;
     }
+    // frames in flight keep reading their own slots
+    m_channelUniformData = std::move(blockData);
+    m_uniformSlotDirty.assign(m_uniformSlotDirty.size(), true);
+}
 
-    const VkWriteDescriptorSet writeDescriptorSet =
+void Renderer::updateUniformSlot(const uint32_t cmdBufferIndex)
+{
+    if (!m_uniformSlotDirty[cmdBufferIndex])
     {
-        VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,     // sType
-        nullptr,                                    // pNext
-        m_descriptorSetImage->descriptorSet,        // dstSet
-        0,                                          // dstBinding
-        0,                                          // dstArrayElement
-        imageCount,                                 // descriptorCount
-        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,  // descriptorType
-        descriptorImageInfoArray.data(),            // pImageInfo
-        nullptr,                                    // pBufferInfo
-        nullptr,                                    // pTexelBufferView
-    };
+        return;
+    }
+    m_uniformSlotDirty[cmdBufferIndex] = false;
 
-    vkUpdateDescriptorSets(
-        mp_gfxDevice->logicalDevice,// device
-        1,                          // descriptorWriteCount
-        &writeDescriptorSet,        // pDescriptorWrites
-        0,                          // descriptorCopyCount
-        nullptr);                   // pDescriptorCopies
+    // host writes are visible to the next queue submission
+    if (m_gpuBufferUniform && !m_channelUniformData.empty())
+    {
+        m_gpuBufferUniform->copyData(cmdBufferIndex,
+            (uint32_t)m_channelUniformData.size(), m_channelUniformData.data());
+    }
+    if (m_gpuBufferParams && !m_paramUniformData.empty())
+    {
+        m_gpuBufferParams->copyData(cmdBufferIndex,
+            (uint32_t)m_paramUniformData.size(), m_paramUniformData.data());
+    }
 }
 
-void Renderer::createRenderPasses()
+void Renderer::loadParams()
 {
-    GfxSwapchain* const gfxSwapchain = mp_gfxResources->getSwapchain();
-    const VkAttachmentDescription attachments[] =
+    ResourceList& rl = ResourceList::getInstance();
+    const std::string filename = rl.shaderPath + "/" + rl.paramFile;
+    std::ifstream file(filename);
+
+    // a removed file resets the parameters to zero
+    m_paramValues.clear();
+    if (!file.is_open())
+    {
+        return;
+    }
+
+    // "name = 1.0 0.5 ..." per line, '#' starts a comment
+    std::string line;
+    uint32_t lineNumber = 0;
+    while (std::getline(file, line))
     {
+        ++lineNumber;
+        line = line.substr(0, line.find('#'));
+        const size_t separator = line.find('=');
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
         {
-            0,                                  // flags
-            gfxSwapchain->imageFormat,          // format
-            VK_SAMPLE_COUNT_1_BIT,              // samples
-            VK_ATTACHMENT_LOAD_OP_CLEAR,        // loadOp
-            VK_ATTACHMENT_STORE_OP_STORE,       // storeOp
-            VK_ATTACHMENT_LOAD_OP_DONT_CARE,    // stencilLoadOp
-            VK_ATTACHMENT_STORE_OP_DONT_CARE,   // stencilStoreOp
-            VK_IMAGE_LAYOUT_UNDEFINED,          // initialLayout
-            VK_IMAGE_LAYOUT_PRESENT_SRC_KHR     // finalLayout
+            continue;
         }
-    };
 
-    constexpr VkAttachmentReference attachmentReferences[] =
-    {
+        std::istringstream nameStream(line.substr(0, separator));
+        std::string name;
+        nameStream >> name;
+        std::istringstream valueStream((separator != std::string::npos) ? line.substr(separator + 1) : "");
+        std::vector<float> values;
+        float value = 0.0f;
+        while (valueStream >> value)
         {
-            0,                                          // attachment
-            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL    // layout
+            values.push_back(value);
         }
-    };
+        if (separator == std::string::npos || name.empty() || values.empty() || !valueStream.eof())
+        {
+            std::cerr << filename << "(" << lineNumber << "): expected name = values" << std::endl;
+            continue;
+        }
+        m_paramValues[name] = std::move(values);
+    }
+}
 
-    constexpr VkSubpassDescription subpassDescription =
+void Renderer::updateParamUniforms()
+{
+    if (!m_gpuBufferParams)
     {
-        0,                              // flags
-        VK_PIPELINE_BIND_POINT_GRAPHICS,// pipelineBindPoint
-        0,                              // inputAttachmentCount
+        return;
+    }
+
+    // parameters missing from the file are zero
+    const SpirvDescriptor* const p_block = m_shader->reflection.findDescriptor(0, 1);
+    std::vector<uint8_t> blockData(m_gpuBufferParams->byteSize, 0);
+    for (const auto& memberRef : p_block->members)
+    {
+        const auto iter = m_paramValues.find(memberRef.name);
+        if (iter == m_paramValues.end())
+        {
+            continue;
+        }
+        if (memberRef.type == SpirvBlockMember::Type::otherType)
+        {
+            std::cerr << "Parameter " << memberRef.name
+                << ": only scalars, vectors and arrays of them are supported" << std::endl;
+            continue;
+        }
+
+        // components are packed in an element, elements are arrayStride apart (std140)
+        const std::vector<float>& values = iter->second;
+        const uint32_t valueCount = std::min((uint32_t)values.size(),
+            memberRef.arrayLength * memberRef.componentCount);
+        for (uint32_t idx = 0; idx < valueCount; ++idx)
+        {
+            const uint32_t offset = memberRef.offset
+                + (idx / memberRef.componentCount) * memberRef.arrayStride
+                + (idx % memberRef.componentCount) * (uint32_t)sizeof(uint32_t);
+            if (offset + sizeof(uint32_t) > blockData.size())
+            {
+                break;
+            }
+
+            const float value = values[idx];
+            uint32_t bits = 0;
+            switch (memberRef.type)
+            {
+            case SpirvBlockMember::Type::boolType:  bits = (value != 0.0f) ? 1 : 0; break;
+            case SpirvBlockMember::Type::intType:   bits = (uint32_t)(int32_t)value; break;
+            case SpirvBlockMember::Type::uintType:  bits = (value > 0.0f) ? (uint32_t)value : 0; break;
+            default:                                memcpy(&bits, &value, sizeof(bits)); break;
+            }
+            memcpy(blockData.data() + offset, &bits, sizeof(bits));
+        }
+    }
+    // a removed param file leaves no values, the whole block is zero
+    assert(!m_paramValues.empty() || std::all_of(blockData.begin(), blockData.end(),
+        [](const uint8_t byte) { return byte == 0; }));
+
+    // frames in flight keep reading their own slots
+    m_paramUniformData = std::move(blockData);
+    m_uniformSlotDirty.assign(m_uniformSlotDirty.size(), true);
+}
+
+void Renderer::updateParams()
+{
+    // the blocks are buffered per command buffer and presets swap in cached pipeline variants,
+    // the gpu is not drained
+    loadParams();
+    updateParamUniforms();
+    loadPresets();
+    updateSpecialization();
+    std::cout << "Shader parameters updated." << std::endl;
+}
+
+float Renderer::getSampleRate() const
+{
+    // the first audio channel
+    for (const auto sampleRateRef : m_imageSet.sampleRates)
+    {
+        if (sampleRateRef > 0)
+        {
+            return (float)sampleRateRef;
+        }
+    }
+    return 44100.0f;
+}
+
+void Renderer::writeShaderInput(uint8_t* const p_blockData,
+    const ShaderInputMember& member,
+    const float (&values)[4])
+{
+    if (member.offset != ~0u)
+    {
+        memcpy(p_blockData + member.offset, values, std::min<size_t>(member.size, sizeof(values)));
+    }
+}
+
+void Renderer::createDescriptorsImage()
+{
+    const ShaderReflection& reflection = m_shader->reflection;
+    const uint32_t setCount = (uint32_t)mp_gfxResources->getCmdBuffer()->commandBuffers.size();
+    assert(setCount <= mp_gfxResources->getDescriptorPool()->c_maxSetsImage);
+
+    m_descriptorSetsImage.clear();
+    for (uint32_t idx = 0; idx < setCount; ++idx)
+    {
+        m_descriptorSetsImage.emplace_back(new DescriptorSet(
+            mp_gfxResources->getDevice(),
+            mp_gfxResources->getDescriptorPool()->images,
+            reflection.getSetLayoutBindings(1)));
+    }
+    m_descriptorSetImageDirty.assign(setCount, true);
+    invalidateDrawCmdBuffers();
+}
+
+void Renderer::invalidateDescriptorsImage()
+{
+    m_descriptorSetImageDirty.assign(m_descriptorSetImageDirty.size(), true);
+}
+
+void Renderer::updateDescriptorSetImage(const uint32_t cmdBufferIndex)
+{
+    if (!m_descriptorSetImageDirty[cmdBufferIndex])
+    {
+        return;
+    }
+    m_descriptorSetImageDirty[cmdBufferIndex] = false;
+    // updating the set invalidates the draw command buffers which bind it
+    m_drawCmdBuffersDirty[cmdBufferIndex] = true;
+
+    // only the channels which the shader samples are bound
+    const ShaderReflection& reflection = m_shader->reflection;
+    const uint32_t imageCount = (uint32_t)m_imageSet.images.size();
+    VkDescriptorImageInfo* const descriptorImageInfoArray =
+        m_frameArena.allocate<VkDescriptorImageInfo>(imageCount);
+    VkWriteDescriptorSet* const writeDescriptorSetArray =
+        m_frameArena.allocate<VkWriteDescriptorSet>(c_channelCount + 1);
+    uint32_t imageInfoCount = 0;
+    uint32_t writeCount = 0;
+    for (uint32_t idx = 0; idx < c_channelCount; ++idx)
+    {
+        const SpirvDescriptor* const p_descriptor = reflection.findDescriptor(1, idx);
+        if (!p_descriptor)
+        {
+            continue;
+        }
+
+        // a used channel whose file is missing or failed to decode gets the placeholder
+        const bool loaded = isChannelLoaded(idx);
+        const GpuImage* const p_image = loaded ?
+            m_imageSet.images[idx].get() : getPlaceholderImage(p_descriptor->imageViewType);
+        const VkDescriptorImageInfo descriptorImageInfo =
+        {
+            loaded ? m_imageSet.samplers[idx] : m_placeholderSampler,   // sampler
+            p_image->imageView,                                         // imageView
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL                    // imageLayout, after the upload
+        };
+        descriptorImageInfoArray[imageInfoCount] = descriptorImageInfo;
+
+        const VkWriteDescriptorSet writeDescriptorSet =
+        {
+            VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,                 // sType
+            nullptr,                                                // pNext
+            m_descriptorSetsImage[cmdBufferIndex]->descriptorSet,   // dstSet
+            idx,                                                    // dstBinding
+            0,                                                      // dstArrayElement
+            1,                                                      // descriptorCount
+            VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,              // descriptorType
+            &descriptorImageInfoArray[imageInfoCount],              // pImageInfo
+            nullptr,                                                // pBufferInfo
+            nullptr,                                                // pTexelBufferView
+        };
+        writeDescriptorSetArray[writeCount] = writeDescriptorSet;
+        ++imageInfoCount;
+        ++writeCount;
+    }
+
+    // the whole texture array is one write, every element the shader can index must be valid
+    // so empty slots get the placeholder image
+    const SpirvDescriptor* const p_array = reflection.findDescriptor(1, c_textureArrayBinding);
+    if (p_array)
+    {
+        const uint32_t firstImageInfo = imageInfoCount;
+        for (uint32_t slot = 0; slot < p_array->descriptorCount; ++slot)
+        {
+            const uint32_t index = c_channelCount + slot;
+            const bool loaded = isChannelLoaded(index);
+            const GpuImage* const p_image = loaded ?
+                m_imageSet.images[index].get() : getPlaceholderImage(p_array->imageViewType);
+            const VkDescriptorImageInfo descriptorImageInfo =
+            {
+                loaded ? m_imageSet.samplers[index] : m_placeholderSampler, // sampler
+                p_image->imageView,                                         // imageView
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL                    // imageLayout
+            };
+            descriptorImageInfoArray[imageInfoCount] = descriptorImageInfo;
+            ++imageInfoCount;
+        }
+
+        const VkWriteDescriptorSet writeDescriptorSet =
+        {
+            VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,                 // sType
+            nullptr,                                                // pNext
+            m_descriptorSetsImage[cmdBufferIndex]->descriptorSet,   // dstSet
+            c_textureArrayBinding,                                  // dstBinding
+            0,                                                      // dstArrayElement
+            p_array->descriptorCount,                               // descriptorCount
+            VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,              // descriptorType
+            &descriptorImageInfoArray[firstImageInfo],              // pImageInfo
+            nullptr,                                                // pBufferInfo
+            nullptr,                                                // pTexelBufferView
+        };
+        writeDescriptorSetArray[writeCount] = writeDescriptorSet;
+        ++writeCount;
+    }
+
+    if (writeCount > 0)
+    {
+        vkUpdateDescriptorSets(
+            mp_gfxDevice->logicalDevice,    // device
+            writeCount,                     // descriptorWriteCount
+            writeDescriptorSetArray,        // pDescriptorWrites
+            0,                              // descriptorCopyCount
+            nullptr);                       // pDescriptorCopies
+    }
+}
+
+void Renderer::createRenderPasses()
+{
+    GfxSwapchain* const gfxSwapchain = mp_gfxResources->getSwapchain();
+    const VkAttachmentDescription attachments[] =
+    {
+        {
+            0,                                  // flags
+            gfxSwapchain->imageFormat,          // format
+            VK_SAMPLE_COUNT_1_BIT,              // samples
+            VK_ATTACHMENT_LOAD_OP_CLEAR,        // loadOp
+            VK_ATTACHMENT_STORE_OP_STORE,       // storeOp
+            VK_ATTACHMENT_LOAD_OP_DONT_CARE,    // stencilLoadOp
+            VK_ATTACHMENT_STORE_OP_DONT_CARE,   // stencilStoreOp
+            VK_IMAGE_LAYOUT_UNDEFINED,          // initialLayout
+            VK_IMAGE_LAYOUT_PRESENT_SRC_KHR     // finalLayout
+        }
+    };
+
+    constexpr VkAttachmentReference attachmentReferences[] =
+    {
+        {
+            0,                                          // attachment
+            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL    // layout
+        }
+    };
+
+    constexpr VkSubpassDescription subpassDescription =
+    {
+        0,                              // flags
+        VK_PIPELINE_BIND_POINT_GRAPHICS,// pipelineBindPoint
+        0,                              // inputAttachmentCount
         nullptr,                        // pInputAttachments
         1,                              // colorAttachmentCount
         &attachmentReferences[0],       // pColorAttachments
@@ -580,8 +1609,8 @@ void Renderer::createFramebuffers()
             m_renderPass,                               // renderPass
             1,                                          // attachmentCount
             &gfxSwapchain->imageViews[idx],             // pAttachments
-            mp_window->getWidth(),                      // width
-            mp_window->getHeight(),                     // height
+            gfxSwapchain->extent.width,                 // width
+            gfxSwapchain->extent.height,                // height
             1,                                          // layers
         };
 
@@ -591,10 +1620,78 @@ void Renderer::createFramebuffers()
             nullptr,                    // pAllocator
             &m_framebuffers[idx]));     // pFramebuffer
     }
+    allocateDrawCmdBuffers();
 }
 
 void Renderer::createGraphicsPipeline()
 {
+    createPipelineLayout();
+
+    m_specializationValues = getSpecializationValues();
+    m_graphicsPipeline = createPipeline(m_specializationValues, mp_gfxResources->getSwapchain()->extent);
+    m_pipelineVariants[m_specializationValues] = m_graphicsPipeline;
+    invalidateDrawCmdBuffers();
+}
+
+void Renderer::createPipelineLayout()
+{
+    std::vector<VkDescriptorSetLayout> setLayouts
+    { m_descriptorSetsUniform[0]->descriptorSetLayout, m_descriptorSetsImage[0]->descriptorSetLayout };
+
+    const ShaderReflection& reflection = m_shader->reflection;
+    const VkPushConstantRange pushConstantRange =
+    {
+        reflection.pushConstantStageFlags,  // stageFlags
+        0,                                  // offset
+        reflection.pushConstantSize         // size
+    };
+
+    const VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo =
+    {
+        VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,  // sType
+        nullptr,                                        // pNext
+        0,                                              // flags
+        (uint32_t)setLayouts.size(),                    // setLayoutCount
+        setLayouts.data(),                              // pSetLayouts
+        reflection.pushConstantSize > 0 ? 1u : 0u,      // pushConstantRangeCount
+        &pushConstantRange                              // pPushConstantRanges
+    };
+
+    CHECK_VK_RESULT_SUCCESS(vkCreatePipelineLayout(
+        mp_gfxDevice->logicalDevice,   // device
+        &pipelineLayoutCreateInfo,  // pCreateInfo
+        nullptr,                    // pAllocator,
+        &m_pipelineLayout));        // pPipelineLayout
+}
+
+VkPipeline Renderer::createPipeline(const std::vector<uint32_t>& specializationValues,
+    const VkExtent2D extent) const
+{
+    // one 32-bit value per reflected specialization constant
+    const std::vector<SpirvSpecConstant>& specConstants = m_shader->reflection.specConstants;
+    assert(specializationValues.size() == specConstants.size());
+    std::vector<VkSpecializationMapEntry> specializationMapEntries(specConstants.size());
+    for (uint32_t idx = 0; idx < specConstants.size(); ++idx)
+    {
+        const VkSpecializationMapEntry specializationMapEntry =
+        {
+            specConstants[idx].constantId,  // constantID
+            idx * (uint32_t)sizeof(uint32_t),// offset
+            sizeof(uint32_t)                // size
+        };
+        specializationMapEntries[idx] = specializationMapEntry;
+    }
+
+    const VkSpecializationInfo specializationInfo =
+    {
+        (uint32_t)specializationMapEntries.size(),          // mapEntryCount
+        specializationMapEntries.data(),                    // pMapEntries
+        specializationValues.size() * sizeof(uint32_t),     // dataSize
+        specializationValues.data()                         // pData
+    };
+    const VkSpecializationInfo* const p_specializationInfo =
+        specConstants.empty() ? nullptr : &specializationInfo;
+
     const VkPipelineShaderStageCreateInfo shaderStageCreateInfo[] =
     {
         {
@@ -604,7 +1701,7 @@ void Renderer::createGraphicsPipeline()
             VK_SHADER_STAGE_VERTEX_BIT,                             // stage
             m_shader->vert,                                         // module
             "main",                                                 // pName
-            nullptr                                                 // pSpecializationInfo
+            p_specializationInfo                                    // pSpecializationInfo
         },
         {
             VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,    // sType
@@ -613,7 +1710,7 @@ void Renderer::createGraphicsPipeline()
             VK_SHADER_STAGE_FRAGMENT_BIT,                           // stage
             m_shader->frag,                                         // module
             "main",                                                 // pName
-            nullptr                                                 // pSpecializationInfo
+            p_specializationInfo                                    // pSpecializationInfo
         }
     };
 
@@ -637,260 +1734,1304 @@ void Renderer::createGraphicsPipeline()
         VK_FALSE                                                        // primitiveRestartEnable
     };
 
-    const uint32_t width = mp_window->getWidth();
-    const uint32_t height = mp_window->getHeight();
+    const uint32_t width = extent.width;
+    const uint32_t height = extent.height;
+
+    const VkViewport viewport =
+    {
+        0.0f,           // x
+        0.0f,           // y
+        (float)width,   // width
+        (float)height,  // height
+        0.0f,           // minDepth
+        1.0f,           // maxDepth
+    };
+
+    const VkRect2D scissor =
+    {
+        { 0, 0 },           // offset
+        { width, height }   // extent
+    };
+
+    const VkPipelineViewportStateCreateInfo viewportStateCreateInfo =
+    {
+        VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,  // sType
+        nullptr,                                                // pNext
+        0,                                                      // flags
+        1,                                                      // viewportCount
+        &viewport,                                              // pViewports
+        1,                                                      // scissorCount
+        &scissor                                                // pScissors
+    };
+
+    constexpr VkPipelineRasterizationStateCreateInfo rasterizationStateCreateInfo =
+    {
+        VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO, // sType
+        nullptr,                                                    // pNext
+        0,                                                          // flags
+        VK_FALSE,                                                   // depthClampEnable
+        VK_FALSE,                                                   // rasterizerDiscardEnable
+        VK_POLYGON_MODE_FILL,                                       // polygonMode
+        VK_CULL_MODE_NONE,                                          // cullMode
+        VK_FRONT_FACE_COUNTER_CLOCKWISE,                            // frontFace
+        VK_FALSE,                                                   // depthBiasEnable
+        0.0f,                                                       // depthBiasConstantFactor
+        0.0f,                                                       // depthBiasClamp
+        0.0f,                                                       // depthBiasSlopeFactor
+        1.0f                                                        // lineWidth
+    };
+
+    constexpr VkPipelineColorBlendAttachmentState colorBlendAttachmentState =
+    {
+        VK_FALSE,                                                   // blendEnable
+        VK_BLEND_FACTOR_ZERO,                                       // srcColorBlendFactor
+        VK_BLEND_FACTOR_ZERO,                                       // dstColorBlendFactor
+        VK_BLEND_OP_ADD,                                            // colorBlendOp
+        VK_BLEND_FACTOR_ZERO,                                       // srcAlphaBlendFactor
+        VK_BLEND_FACTOR_ZERO,                                       // dstAlphaBlendFactor
+        VK_BLEND_OP_ADD,                                            // alphaBlendOp
+        VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT
+        | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,  // colorWriteMask
+    };
+
+    constexpr VkPipelineColorBlendStateCreateInfo colorBlendStateCreateInfo =
+    {
+        VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,   // sType
+        nullptr,                                                    // pNext
+        0,                                                          // flags
+        VK_FALSE,                                                   // logicOpEnable
+        VK_LOGIC_OP_COPY,                                           // logicOp
+        1,                                                          // attachmentCount
+        &colorBlendAttachmentState,                                 // pAttachments
+        { 0.0f, 0.0f, 0.0f, 0.0f }                                  // blendConstants[4]
+    };
+
+    constexpr VkPipelineMultisampleStateCreateInfo multisampleStateCreateInfo =
+    {
+        VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,   // sType
+        nullptr,                                                    // pNext
+        0,                                                          // flags
+        VK_SAMPLE_COUNT_1_BIT,                                      // rasterizationSamples
+        VK_FALSE,                                                   // sampleShadingEnable
+        1.0f,                                                       // minSampleShading
+        nullptr,                                                    // pSampleMask
+        VK_FALSE,                                                   // alphaToCoverageEnable
+        VK_FALSE,                                                   // alphaToOneEnable
+    };
+
+    const VkGraphicsPipelineCreateInfo pipelineCreateInfo =
+    {
+        VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,    // sType
+        nullptr,                        // pNext
+        0,                              // flags
+        2,                              // stageCount
+        &shaderStageCreateInfo[0],      // pStages
+        &vertexInputStateCreateInfo,    // pVertexInputState
+        &inputAssemblyStateCreateInfo,  // pInputAssemblyState
+        nullptr,                        // pTessellationState
+        &viewportStateCreateInfo,       // pViewportState
+        &rasterizationStateCreateInfo,  // pRasterizationState
+        &multisampleStateCreateInfo,    // pMultisampleState
+        nullptr,                        // pDepthStencilState
+        &colorBlendStateCreateInfo,     // pColorBlendState
+        nullptr,                        // pDynamicState
+        m_pipelineLayout,               // layout
+        m_renderPass,                   // renderPass
+        0,                              // subpass
+        nullptr,                        // basePipelineHandle
+        0                               // basePipelineIndex
+    };
+
+    // the pipeline cache is internally synchronized, pipelines can be created by jobs
+    VkPipeline pipeline = nullptr;
+    CHECK_VK_RESULT_SUCCESS(vkCreateGraphicsPipelines(
+        mp_gfxDevice->logicalDevice,   // device
+        m_pipelineCache,            // pipelineCache
+        1,                          // createInfoCount
+        &pipelineCreateInfo,        // pCreateInfos
+        nullptr,                    // pAllocator
+        &pipeline));                // pPipelines
+    return pipeline;
+}
+
+void Renderer::cancelPipelineJob()
+{
+    if (m_pipelineJob)
+    {
+        mp_jobSystem->wait(m_pipelineJob);
+        m_pipelineJob.reset();
+        vkDestroyPipeline(mp_gfxDevice->logicalDevice, m_pendingPipeline, nullptr);
+        m_pendingPipeline = nullptr;
+        m_pipelineVariants.erase(m_pendingSpecializationValues);
+    }
+}
+
+void Renderer::destroyGraphicsPipeline()
+{
+    // a background rebuild uses the layout and the shader
+    cancelPipelineJob();
+    for (const auto& variantRef : m_pipelineVariants)
+    {
+        vkDestroyPipeline(mp_gfxDevice->logicalDevice, variantRef.second, nullptr);
+    }
+    m_pipelineVariants.clear();
+
+    vkDestroyPipelineLayout(mp_gfxDevice->logicalDevice, m_pipelineLayout, nullptr);
+    m_pipelineLayout = nullptr;
+    m_graphicsPipeline = nullptr;
+}
+
+// Converts a preset value to the bits of the constant type.
+static bool parseSpecConstantValue(const std::string& text,
+    const SpirvSpecConstant::Type type,
+    uint32_t& value)
+{
+    std::istringstream stream(text);
+    switch (type)
+    {
+    case SpirvSpecConstant::Type::boolType:
+    {
+        if (text == "true" || text == "false")
+        {
+            value = (text == "true") ? 1 : 0;
+            return true;
+        }
+        uint32_t number = 0;
+        stream >> number;
+        value = (number != 0) ? 1 : 0;
+    } break;
+    case SpirvSpecConstant::Type::intType:
+    {
+        int32_t number = 0;
+        stream >> number;
+        memcpy(&value, &number, sizeof(value));
+    } break;
+    case SpirvSpecConstant::Type::uintType:
+        stream >> value;
+        break;
+    case SpirvSpecConstant::Type::floatType:
+    {
+        float number = 0.0f;
+        stream >> number;
+        memcpy(&value, &number, sizeof(value));
+    } break;
+    }
+    return !stream.fail() && (stream >> std::ws).eof();
+}
+
+std::vector<uint32_t> Renderer::getSpecializationValues() const
+{
+    const std::vector<SpirvSpecConstant>& specConstants = m_shader->reflection.specConstants;
+    std::vector<uint32_t> values(specConstants.size());
+    for (uint32_t idx = 0; idx < specConstants.size(); ++idx)
+    {
+        values[idx] = specConstants[idx].defaultValue;
+    }
+
+    // switches and quality knobs of the selected preset
+    if (m_presetIndex < m_presets.size())
+    {
+        for (const auto& presetValueRef : m_presets[m_presetIndex].values)
+        {
+            for (uint32_t idx = 0; idx < specConstants.size(); ++idx)
+            {
+                if (specConstants[idx].name == presetValueRef.first
+                    && !parseSpecConstantValue(presetValueRef.second, specConstants[idx].type, values[idx]))
+                {
+                    std::cerr << "Preset value not valid: " << presetValueRef.first
+                        << " = " << presetValueRef.second << std::endl;
+                    values[idx] = specConstants[idx].defaultValue;
+                }
+            }
+        }
+    }
+
+    // session-constant inputs (DEF_SPECIALIZE_INPUTS in toy.frag)
+    auto setFloat = [&specConstants, &values](const std::string& name, const float value)
+    {
+        for (uint32_t idx = 0; idx < specConstants.size(); ++idx)
+        {
+            if (specConstants[idx].name == name)
+            {
+                memcpy(&values[idx], &value, sizeof(value));
+            }
+        }
+    };
+    const VkExtent2D extent = mp_gfxResources->getSwapchain()->extent;
+    setFloat("iResolutionX_", (float)extent.width);
+    setFloat("iResolutionY_", (float)extent.height);
+    setFloat("iResolutionZ_", (float)extent.width / (float)extent.height);
+    for (uint32_t idx = 0; idx < c_channelCount; ++idx)
+    {
+        const GpuImage* const p_image = m_imageSet.images[idx].get();
+        const std::string name = "iChannelResolution" + std::to_string(idx);
+        setFloat(name + "X_", p_image ? (float)p_image->size.width : 0.0f);
+        setFloat(name + "Y_", p_image ? (float)p_image->size.height : 0.0f);
+        setFloat(name + "Z_", p_image ? (float)p_image->size.depth : 0.0f);
+    }
+    setFloat("iSampleRate_", getSampleRate());
+    return values;
+}
+
+void Renderer::updateSpecialization()
+{
+    const std::vector<uint32_t> values = getSpecializationValues();
+    if (m_pipelineJob && values == m_pendingSpecializationValues)
+    {
+        return;
+    }
+    // outdated before it was used
+    cancelPipelineJob();
+    if (values == m_specializationValues)
+    {
+        return;
+    }
+
+    // cached variants are swapped in for the next frame,
+    // frames in flight keep using the previous variant which stays cached
+    const auto iter = m_pipelineVariants.find(values);
+    if (iter != m_pipelineVariants.end())
+    {
+        m_graphicsPipeline = iter->second;
+        m_specializationValues = values;
+        invalidateDrawCmdBuffers();
+        return;
+    }
+
+    if (m_pipelineVariants.size() >= c_maxPipelineVariants)
+    {
+        // frames in flight might use any variant, only the full cache is drained
+        mp_gfxResources->waitForIdle();
+        for (auto iterVariant = m_pipelineVariants.begin(); iterVariant != m_pipelineVariants.end();)
+        {
+            if (iterVariant->second != m_graphicsPipeline)
+            {
+                vkDestroyPipeline(mp_gfxDevice->logicalDevice, iterVariant->second, nullptr);
+                iterVariant = m_pipelineVariants.erase(iterVariant);
+            }
+            else
+            {
+                ++iterVariant;
+            }
+        }
+    }
+
+    // frames are rendered with the current variant until the new one is ready,
+    // its cache entry is added here so that the swap does not allocate
+    std::cout << "Specialization constants changed, building a pipeline variant." << std::endl;
+    m_pendingSpecializationValues = values;
+    m_pipelineVariants[values] = nullptr;
+    const VkExtent2D extent = mp_gfxResources->getSwapchain()->extent;
+    m_pipelineJob = mp_jobSystem->run([this, extent]()
+    {
+        m_pendingPipeline = createPipeline(m_pendingSpecializationValues, extent);
+    });
+}
+
+void Renderer::swapSpecializedPipeline()
+{
+    if (!m_pipelineJob || !m_pipelineJob->isDone())
+    {
+        return;
+    }
+
+    mp_jobSystem->wait(m_pipelineJob);
+    m_pipelineJob.reset();
+    m_pipelineVariants.find(m_pendingSpecializationValues)->second = m_pendingPipeline;
+    m_graphicsPipeline = m_pendingPipeline;
+    m_pendingPipeline = nullptr;
+    std::swap(m_specializationValues, m_pendingSpecializationValues);
+    invalidateDrawCmdBuffers();
+}
+
+void Renderer::loadPresets()
+{
+    ResourceList& rl = ResourceList::getInstance();
+    const std::string filename = rl.shaderPath + "/" + rl.presetFile;
+    std::ifstream file(filename);
+
+    // a removed file drops the presets, the constants go back to the shader defaults
+    m_presets.clear();
+    if (!file.is_open())
+    {
+        m_presetIndex = 0;
+        return;
+    }
+
+    // "[name]" starts a preset, followed by "constant = value" lines, '#' starts a comment
+    std::string line;
+    uint32_t lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        ++lineNumber;
+        line = line.substr(0, line.find('#'));
+        const size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos)
+        {
+            continue;
+        }
+        line = line.substr(first, line.find_last_not_of(" \t\r") - first + 1);
+
+        if (line.front() == '[' && line.back() == ']')
+        {
+            SpecializationPreset preset;
+            preset.name = line.substr(1, line.size() - 2);
+            m_presets.emplace_back(std::move(preset));
+            continue;
+        }
+
+        std::istringstream lineStream(line);
+        std::string name;
+        std::string separator;
+        std::string value;
+        lineStream >> name >> separator >> value;
+        if (m_presets.empty() || separator != "=" || value.empty() || !(lineStream >> std::ws).eof())
+        {
+            std::cerr << filename << "(" << lineNumber << "): expected [preset] or constant = value" << std::endl;
+            continue;
+        }
+        m_presets.back().values.emplace_back(name, value);
+    }
+
+    if (m_presetIndex >= m_presets.size())
+    {
+        m_presetIndex = 0;
+    }
+}
+
+void Renderer::selectPreset(const uint32_t presetIndex)
+{
+    if (presetIndex >= m_presets.size())
+    {
+        std::cout << "No preset " << presetIndex + 1 << "." << std::endl;
+        return;
+    }
+    m_presetIndex = presetIndex;
+    std::cout << "Preset " << presetIndex + 1 << ": " << m_presets[presetIndex].name << std::endl;
+    updateSpecialization();
+}
+
+size_t Renderer::getFrameArenaHighWaterMark() const
+{
+    return m_frameArena.getHighWaterMark();
+}
+
+void Renderer::createPipelineCache(const std::vector<uint8_t>& initialData)
+{
+    // header: length, version, vendor id, device id and cache uuid
+    constexpr size_t headerSize = 4 * sizeof(uint32_t) + VK_UUID_SIZE;
+    const VkPhysicalDeviceProperties& properties = mp_gfxDevice->physicalDeviceProperties;
+    bool valid = initialData.size() >= headerSize;
+    if (valid)
+    {
+        uint32_t header[4];
+        memcpy(header, initialData.data(), sizeof(header));
+        valid = header[0] >= headerSize
+            && header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+            && header[2] == properties.vendorID
+            && header[3] == properties.deviceID
+            && memcmp(initialData.data() + sizeof(header),
+                properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+    }
+    if (!valid && !initialData.empty())
+    {
+        std::cerr << "Pipeline cache is from another device or driver, ignored" << std::endl;
+    }
+
+    const VkPipelineCacheCreateInfo pipelineCacheCreateInfo =
+    {
+        VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,   // sType
+        nullptr,                                        // pNext
+        0,                                              // flags
+        valid ? initialData.size() : 0,                 // initialDataSize
+        valid ? initialData.data() : nullptr            // pInitialData
+    };
+
+    CHECK_VK_RESULT_SUCCESS(vkCreatePipelineCache(
+        mp_gfxDevice->logicalDevice,    // device
+        &pipelineCacheCreateInfo,       // pCreateInfo
+        nullptr,                        // pAllocator
+        &m_pipelineCache));             // pPipelineCache
+}
+
+void Renderer::savePipelineCache()
+{
+    size_t dataSize = 0;
+    CHECK_VK_RESULT_SUCCESS(vkGetPipelineCacheData(
+        mp_gfxDevice->logicalDevice,    // device
+        m_pipelineCache,                // pipelineCache
+        &dataSize,                      // pDataSize
+        nullptr));                      // pData
+    std::vector<uint8_t> data(dataSize);
+    CHECK_VK_RESULT_SUCCESS(vkGetPipelineCacheData(
+        mp_gfxDevice->logicalDevice,    // device
+        m_pipelineCache,                // pipelineCache
+        &dataSize,                      // pDataSize
+        data.data()));                  // pData
+
+    ResourceList& rl = ResourceList::getInstance();
+    std::ofstream file(rl.pipelineCacheFile, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        std::cerr << "Could not write " << rl.pipelineCacheFile << std::endl;
+        return;
+    }
+    file.write(reinterpret_cast<const char*>(data.data()), dataSize);
+}
+
+void Renderer::resizeFramebuffer()
+{
+    // exempt from buffering: resizeWindow has already drained the gpu to recreate the swapchain,
+    // the framebuffers and the pipeline of the old extent go with it (the wait returns right away)
+    mp_gfxResources->waitForIdle();
+
+    for (uint32_t idx = 0; idx < m_framebuffers.size(); ++idx)
+    {
+        vkDestroyFramebuffer(mp_gfxDevice->logicalDevice,
+            m_framebuffers[idx], nullptr);
+    }
+    destroyGraphicsPipeline();
+
+    createGraphicsPipeline();
+    createFramebuffers();
+}
+
+void Renderer::createImageSet()
+{
+    ResourceList& rl = ResourceList::getInstance();
+    assert(rl.imageFiles.size() == c_channelCount);
+    assert(rl.imageArraySize <= mp_gfxResources->getDescriptorPool()->c_maxTextureArraySize);
+    const uint32_t imageCount = c_channelCount + rl.imageArraySize;
+    m_imageSet.stagingBuffers.resize(imageCount);
+    m_imageSet.images.resize(imageCount);
+    m_imageSet.samplers.resize(imageCount);
+    m_imageSet.dirtyFlags.resize(imageCount);
+    m_imageSet.streams.resize(imageCount);
+    m_imageSet.sampleRates.resize(imageCount, 0);
+    m_imageSet.streamSlotsInFlight.resize(
+        mp_gfxResources->getCmdBuffer()->commandBuffers.size());
+    // at most one slot per channel, the frame loop does not allocate
+    for (auto&& slotsRef : m_imageSet.streamSlotsInFlight)
+    {
+        slotsRef.reserve(imageCount);
+    }
+
+    // changed files are matched to the channels with one lookup
+    for (uint32_t idx = 0; idx < c_channelCount; ++idx)
+    {
+        const std::string& channelName = rl.imageFilesForSearch[idx];
+        m_imageFileNames[channelName] = idx;
+        m_imageFileNames[rl.getImageSequenceFrameName(channelName, 0)] = idx;
+        for (const auto& suffixRef : rl.imageCubeFaceSuffixes)
+        {
+            m_imageFileNames[channelName + suffixRef] = idx;
+        }
+    }
+    for (uint32_t idx = 0; idx < rl.imageArraySize; ++idx)
+    {
+        m_imageFileNames[rl.imageArrayName + std::to_string(idx)] = c_channelCount + idx;
+    }
+}
+
+void Renderer::createPlaceholderImage()
+{
+    const VkExtent3D extent = { 1, 1, 1 };
+    const auto createImage = [this, &extent](const VkImageViewType viewType)
+    {
+        std::shared_ptr<GpuImage> image(new GpuImage(
+            mp_gfxDevice,
+            extent,
+            viewType,
+            VK_FORMAT_R8G8B8A8_UNORM,
+            VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            VkImageLayout::VK_IMAGE_LAYOUT_UNDEFINED,
+            getComponentMapping(4)));
+        m_imageSet.clears.push_back(image);
+        return image;
+    };
+    m_placeholderImage = createImage(VK_IMAGE_VIEW_TYPE_2D);
+    m_placeholderCubeImage = createImage(VK_IMAGE_VIEW_TYPE_CUBE);
+    m_placeholderVolumeImage = createImage(VK_IMAGE_VIEW_TYPE_3D);
+    m_placeholderSampler = m_samplerCache->getSampler(SamplerState());
+    m_imageSet.dirty = true;
+}
+
+const GpuImage* Renderer::getPlaceholderImage(const VkImageViewType viewType) const
+{
+    switch (viewType)
+    {
+    case VK_IMAGE_VIEW_TYPE_CUBE: return m_placeholderCubeImage.get();
+    case VK_IMAGE_VIEW_TYPE_3D: return m_placeholderVolumeImage.get();
+    default: return m_placeholderImage.get();
+    }
+}
+
+std::vector<std::unique_ptr<Renderer::ImageUpload> > Renderer::beginImages()
+{
+    std::vector<std::unique_ptr<ImageUpload> > uploads;
+    for (uint32_t idx = 0; idx < m_imageSet.images.size(); ++idx)
+    {
+        if (!isChannelUsed(idx))
+        {
+            continue;
+        }
+        std::unique_ptr<ImageUpload> upload = beginChannel(idx);
+        if (upload)
+        {
+            uploads.emplace_back(std::move(upload));
+        }
+    }
+    return uploads;
+}
+
+std::unique_ptr<Renderer::ImageUpload> Renderer::beginChannel(const uint32_t index)
+{
+    // texture array slots are optional 2D images
+    if (index >= c_channelCount)
+    {
+        const std::string slotFile = getTextureArraySlotFile(index - c_channelCount);
+        return fileExists(slotFile) ?
+            beginImageUpload(index, { slotFile }, VK_IMAGE_VIEW_TYPE_2D) : nullptr;
+    }
+
+    // sequences, cube faces, volume and audio files are preferred over the default 2D image
+    if (createImageSequence(index))
+    {
+        return nullptr;
+    }
+    VkImageViewType viewType = VK_IMAGE_VIEW_TYPE_2D;
+    const std::vector<std::string> imageFiles = getChannelImageFiles(index, viewType);
+    if (!imageFiles.empty())
+    {
+        return beginImageUpload(index, imageFiles, viewType);
+    }
+    // the default 2D image if the audio file is not valid
+    ResourceList& rl = ResourceList::getInstance();
+    const std::string audioFile = rl.imagePath + "/" + rl.imageFilesForSearch[index] + rl.audioExtension;
+    if (createAudioChannel(index, audioFile))
+    {
+        return nullptr;
+    }
+    return beginImageUpload(index, { rl.imagePath + "/" + rl.imageFiles[index] },
+        VK_IMAGE_VIEW_TYPE_2D);
+}
+
+void Renderer::releaseChannel(const uint32_t index)
+{
+    destroyImageStream(index);
+    retireChannel(index);
+    m_imageSet.dirtyFlags[index] = false;
+}
+
+void Renderer::retireChannel(const uint32_t index)
+{
+    if (!m_imageSet.images[index] && !m_imageSet.stagingBuffers[index])
+    {
+        return;
+    }
+    for (uint32_t idx = 0; m_imageSet.dirtyFlags[index] && idx < m_imageSet.images.size(); ++idx)
+    {
+        if (idx != index && m_imageSet.images[idx] == m_imageSet.images[index])
+        {
+            m_imageSet.stagingBuffers[idx] = std::move(m_imageSet.stagingBuffers[index]);
+            m_imageSet.dirtyFlags[idx] = true;
+            m_imageSet.dirtyFlags[index] = false;
+        }
+    }
+    ImageSet::RetiredChannel retired;
+    retired.image = std::move(m_imageSet.images[index]);
+    retired.stagingBuffer = std::move(m_imageSet.stagingBuffers[index]);
+    retired.frameCount = (uint32_t)mp_gfxResources->getCmdBuffer()->commandBuffers.size();
+    m_imageSet.retired.emplace_back(std::move(retired));
+}
+
+bool Renderer::isChannelLoaded(const uint32_t index) const
+{
+    return m_imageSet.images[index] != nullptr;
+}
+
+bool Renderer::isChannelUsed(const uint32_t index) const
+{
+    if (!m_shader)
+    {
+        return false;
+    }
+    if (index >= c_channelCount)
+    {
+        const SpirvDescriptor* const p_array = m_shader->reflection.findDescriptor(1, c_textureArrayBinding);
+        return p_array && index - c_channelCount < p_array->descriptorCount;
+    }
+    return m_shader->reflection.findDescriptor(1, index) != nullptr;
+}
+
+void Renderer::updateChannels()
+{
+    std::vector<std::unique_ptr<ImageUpload> > uploads;
+    for (uint32_t idx = 0; idx < m_imageSet.images.size(); ++idx)
+    {
+        // texture array slots are loaded and released silently, most of them are empty
+        const bool used = isChannelUsed(idx);
+        const bool channel = idx < c_channelCount;
+        if (!used && isChannelLoaded(idx))
+        {
+            if (channel)
+            {
+                std::cout << "Channel " << idx << " is not used, released." << std::endl;
+            }
+            releaseChannel(idx);
+        }
+        else if (used && !isChannelLoaded(idx))
+        {
+            if (channel)
+            {
+                std::cout << "Channel " << idx << " is used, loading." << std::endl;
+            }
+            std::unique_ptr<ImageUpload> upload = beginChannel(idx);
+            if (upload)
+            {
+                uploads.emplace_back(std::move(upload));
+            }
+        }
+    }
+
+    // channels are decoded in parallel
+    for (auto&& uploadRef : uploads)
+    {
+        endImageUpload(*uploadRef);
+        m_imageSet.dirty = true;
+    }
+}
+
+void Renderer::createImage(const uint32_t index,
+    const std::vector<std::string>& filenames,
+    const VkImageViewType viewType)
+{
+    std::unique_ptr<ImageUpload> upload = beginImageUpload(index, filenames, viewType);
+    if (upload)
+    {
+        endImageUpload(*upload);
+    }
+}
+
+std::unique_ptr<Renderer::ImageUpload> Renderer::beginImageUpload(const uint32_t index,
+    const std::vector<std::string>& filenames,
+    const VkImageViewType viewType)
+{
+    assert(filenames.size() == ((viewType == VK_IMAGE_VIEW_TYPE_CUBE) ? 6 : 1));
+
+    std::unique_ptr<ImageUpload> upload(new ImageUpload());
+    upload->index = index;
+    upload->viewType = viewType;
+    upload->filenames = filenames;
+
+    std::vector<std::unique_ptr<ImageLoader> >& imgLoaders = upload->imgLoaders;
+    for (const auto& filenameRef : filenames)
+    {
+        imgLoaders.emplace_back(new ImageLoader(filenameRef));
+        const ImageLoader& imgLoader = *imgLoaders.back();
+        const ImageLoader& firstImgLoader = *imgLoaders.front();
+        if (!imgLoader.isValid()
+            || imgLoader.getSize() != firstImgLoader.getSize()
+            || imgLoader.getChannelCount() != firstImgLoader.getChannelCount()
+            || imgLoader.getComponentType() != firstImgLoader.getComponentType())
+        {
+            std::cerr << "image not valid or does not match the first layer: " << filenameRef << std::endl;
+            return nullptr;
+        }
+    }
+
+    const ImageLoader& imgLoader = *imgLoaders.front();
+    if (viewType == VK_IMAGE_VIEW_TYPE_CUBE
+        && std::get<0>(imgLoader.getSize()) != std::get<1>(imgLoader.getSize()))
+    {
+        std::cerr << "cube faces need to be square: " << filenames[0] << std::endl;
+        return nullptr;
+    }
+    const bool isVolume = (viewType == VK_IMAGE_VIEW_TYPE_3D);
+    if (isVolume != (std::get<2>(imgLoader.getSize()) > 1))
+    {
+        std::cerr << "volume channels need a volume file: " << filenames[0] << std::endl;
+        return nullptr;
+    }
+
+    const ImageFormat imageFormat = getImageFormat(
+        mp_gfxDevice,
+        imgLoader.getChannelCount(),
+        imgLoader.getComponentType(),
+        !isVolume); // volumes are data (e.g. noise)
+    upload->format = imageFormat.format;
+    upload->componentType = imageFormat.componentType;
+    upload->channelCount = imageFormat.channelCount;
+    upload->extent =
+    {
+        std::get<0>(imgLoader.getSize()),   // width
+        std::get<1>(imgLoader.getSize()),   // height
+        std::get<2>(imgLoader.getSize()),   // depth
+    };
+
+    // identical files of another channel (or texture array slot) are not decoded again,
+    // hashing the files is cheap compared to decoding
+    TextureRegistry::Key& key = upload->textureKey;
+    key.width = upload->extent.width;
+    key.height = upload->extent.height;
+    key.depth = upload->extent.depth;
+    key.viewType = viewType;
+    key.format = imageFormat.format;
+    key.contentHash = 14695981039346656037ull;
+    for (const auto& filenameRef : filenames)
+    {
+        uint64_t fileHash = 0;
+        uint64_t fileByteSize = 0;
+        if (!getFileHash(filenameRef, fileHash, fileByteSize))
+        {
+            std::cerr << "image not readable: " << filenameRef << std::endl;
+            return nullptr;
+        }
+        key.contentHash = (key.contentHash ^ fileHash) * 1099511628211ull;
+        key.byteSize += fileByteSize;
+    }
+    upload->sharedImage = m_textureRegistry.find(key);
+    upload->waitForShared = !upload->sharedImage && !m_textureRegistry.beginLoad(key);
+    if (upload->sharedImage || upload->waitForShared)
+    {
+        return upload;
+    }
+
+    beginImageDecode(*upload);
+    return upload;
+}
 
-    const VkViewport viewport =
+void Renderer::beginImageDecode(ImageUpload& upload)
+{
+    // decode straight to the mapped staging memory, one job per layer
+    const std::vector<std::unique_ptr<ImageLoader> >& imgLoaders = upload.imgLoaders;
+    const uint32_t layerByteSize = imgLoaders.front()->getBytesize(upload.componentType, upload.channelCount);
+    upload.stagingBuffer.reset(new GpuBufferStaging(
+        mp_gfxDevice,
+        layerByteSize * (uint32_t)imgLoaders.size()));
+    uint8_t* const p_stagingData = upload.stagingBuffer->map();
+    upload.decodedLayers.resize(imgLoaders.size(), 0);
+    for (uint32_t idx = 0; idx < imgLoaders.size(); ++idx)
     {
-        0.0f,           // x
-        0.0f,           // y
-        (float)width,   // width
-        (float)height,  // height
-        0.0f,           // minDepth
-        1.0f,           // maxDepth
-    };
+        const ImageLoader* const p_imgLoader = imgLoaders[idx].get();
+        uint8_t* const p_decoded = &upload.decodedLayers[idx];
+        uint8_t* const p_dst = p_stagingData + idx * layerByteSize;
+        const ImageComponentType componentType = upload.componentType;
+        const uint32_t channelCount = upload.channelCount;
+        upload.decodeJobs.emplace_back(mp_jobSystem->run(
+            [p_imgLoader, p_decoded, p_dst, componentType, channelCount]()
+        {
+            *p_decoded = p_imgLoader->decode(p_dst, componentType, channelCount) ? 1 : 0;
+        }));
+    }
+}
 
-    const VkRect2D scissor =
+void Renderer::endImageUpload(ImageUpload& upload)
+{
+    const uint32_t index = upload.index;
+    if (upload.waitForShared)
     {
-        { 0, 0 },           // offset
-        { width, height }   // extent
-    };
-
-    const VkPipelineViewportStateCreateInfo viewportStateCreateInfo =
+        // ended after the upload decoding the content, which failed if there is no image
+        upload.sharedImage = m_textureRegistry.find(upload.textureKey);
+        if (!upload.sharedImage)
+        {
+            beginImageDecode(upload);
+        }
+    }
+    if (upload.sharedImage)
     {
-        VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,  // sType
-        nullptr,                                                // pNext
-        0,                                                      // flags
-        1,                                                      // viewportCount
-        &viewport,                                              // pViewports
-        1,                                                      // scissorCount
-        &scissor                                                // pScissors
-    };
+        std::cout << "Image shared with an identical channel: " << upload.filenames[0] << std::endl;
+        destroyImageStream(index);
+        retireChannel(index);
+        m_imageSet.images[index] = std::move(upload.sharedImage);
+        m_imageSet.samplers[index] = getChannelSampler(index, upload.viewType, false);
+        m_imageSet.dirtyFlags[index] = false;
+        return;
+    }
 
-    constexpr VkPipelineRasterizationStateCreateInfo rasterizationStateCreateInfo =
+    mp_jobSystem->wait(upload.decodeJobs);
+    upload.stagingBuffer->unmap();
+    if (std::find(upload.decodedLayers.begin(), upload.decodedLayers.end(), 0) != upload.decodedLayers.end())
     {
-        VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO, // sType
-        nullptr,                                                    // pNext
-        0,                                                          // flags
-        VK_FALSE,                                                   // depthClampEnable
-        VK_FALSE,                                                   // rasterizerDiscardEnable
-        VK_POLYGON_MODE_FILL,                                       // polygonMode
-        VK_CULL_MODE_NONE,                                          // cullMode
-        VK_FRONT_FACE_COUNTER_CLOCKWISE,                            // frontFace
-        VK_FALSE,                                                   // depthBiasEnable
-        0.0f,                                                       // depthBiasConstantFactor
-        0.0f,                                                       // depthBiasClamp
-        0.0f,                                                       // depthBiasSlopeFactor
-        1.0f                                                        // lineWidth
-    };
+        m_textureRegistry.endLoad(upload.textureKey, nullptr);
+        return;
+    }
 
-    constexpr VkPipelineColorBlendAttachmentState colorBlendAttachmentState =
+    destroyImageStream(index);
+    retireChannel(index);
+    m_imageSet.stagingBuffers[index].reset(upload.stagingBuffer.release());
+
+    m_imageSet.images[index].reset(new GpuImage(
+        mp_gfxDevice,
+        upload.extent,
+        upload.viewType,
+        upload.format,
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VkImageLayout::VK_IMAGE_LAYOUT_UNDEFINED,
+        getComponentMapping(upload.channelCount)));
+    m_imageSet.samplers[index] = getChannelSampler(index, upload.viewType, false);
+    m_textureRegistry.endLoad(upload.textureKey, m_imageSet.images[index]);
+
+    m_imageSet.dirtyFlags[index] = true;
+}
+
+bool Renderer::createImageSequence(const uint32_t index)
+{
+    ResourceList& rl = ResourceList::getInstance();
+    const std::vector<std::string> frameFiles =
+        getSequenceFrameFiles(rl.imageFilesForSearch[index]);
+    if (frameFiles.empty())
     {
-        VK_FALSE,                                                   // blendEnable
-        VK_BLEND_FACTOR_ZERO,                                       // srcColorBlendFactor
-        VK_BLEND_FACTOR_ZERO,                                       // dstColorBlendFactor
-        VK_BLEND_OP_ADD,                                            // colorBlendOp
-        VK_BLEND_FACTOR_ZERO,                                       // srcAlphaBlendFactor
-        VK_BLEND_FACTOR_ZERO,                                       // dstAlphaBlendFactor
-        VK_BLEND_OP_ADD,                                            // alphaBlendOp
-        VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT
-        | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,  // colorWriteMask
-    };
+        return false;
+    }
 
-    constexpr VkPipelineColorBlendStateCreateInfo colorBlendStateCreateInfo =
+    // the first frame defines the size and format of the sequence
+    ImageLoader imgLoader(frameFiles[0]);
+    if (!imgLoader.isValid() || std::get<2>(imgLoader.getSize()) > 1)
     {
-        VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,   // sType
-        nullptr,                                                    // pNext
-        0,                                                          // flags
-        VK_FALSE,                                                   // logicOpEnable
-        VK_LOGIC_OP_COPY,                                           // logicOp
-        1,                                                          // attachmentCount
-        &colorBlendAttachmentState,                                 // pAttachments
-        { 0.0f, 0.0f, 0.0f, 0.0f }                                  // blendConstants[4]
-    };
+        std::cerr << "image sequence first frame not valid: " << frameFiles[0] << std::endl;
+        return false;
+    }
 
-    constexpr VkPipelineMultisampleStateCreateInfo multisampleStateCreateInfo =
+    const ImageFormat imageFormat = getImageFormat(
+        mp_gfxDevice,
+        imgLoader.getChannelCount(),
+        imgLoader.getComponentType(),
+        true);
+
+    destroyImageStream(index);
+    retireChannel(index);
+    m_imageSet.streams[index].reset(new ImageSequence(
+        mp_gfxDevice,
+        frameFiles,
+        rl.imageSequenceFps,
+        imageFormat.componentType,
+        imageFormat.channelCount,
+        imgLoader.getBytesize(imageFormat.componentType, imageFormat.channelCount),
+        c_bufferingCount));
+
+    const VkExtent3D extent =
     {
-        VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,   // sType
-        nullptr,                                                    // pNext
-        0,                                                          // flags
-        VK_SAMPLE_COUNT_1_BIT,                                      // rasterizationSamples
-        VK_FALSE,                                                   // sampleShadingEnable
-        1.0f,                                                       // minSampleShading
-        nullptr,                                                    // pSampleMask
-        VK_FALSE,                                                   // alphaToCoverageEnable
-        VK_FALSE,                                                   // alphaToOneEnable
+        std::get<0>(imgLoader.getSize()),   // width
+        std::get<1>(imgLoader.getSize()),   // height
+        1,                                  // depth
     };
 
-    std::vector<VkDescriptorSetLayout> setLayouts
-    { m_descriptorSetUniform->descriptorSetLayout, m_descriptorSetImage->descriptorSetLayout };
-    
-    const VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo =
+    m_imageSet.images[index].reset(new GpuImage(
+        mp_gfxDevice,
+        extent,
+        VK_IMAGE_VIEW_TYPE_2D,
+        imageFormat.format,
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VkImageLayout::VK_IMAGE_LAYOUT_UNDEFINED,
+        getComponentMapping(imageFormat.channelCount)));
+    m_imageSet.samplers[index] = getChannelSampler(index, VK_IMAGE_VIEW_TYPE_2D, false);
+
+    // frames are copied from the sequence staging buffers,
+    // cleared until the first one is decoded so the image is never sampled undefined
+    m_imageSet.dirtyFlags[index] = false;
+    m_imageSet.clears.push_back(m_imageSet.images[index]);
+    m_imageSet.dirty = true;
+
+    std::cout << "Image sequence with " << frameFiles.size() << " frames: "
+        << frameFiles[0] << std::endl;
+
+    return true;
+}
+
+bool Renderer::createAudioChannel(const uint32_t index, const std::string& filename)
+{
+    std::unique_ptr<AudioAnalyzer> audioAnalyzer(new AudioAnalyzer(mp_gfxDevice, filename, c_bufferingCount));
+    if (!audioAnalyzer->isValid())
     {
-        VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,  // sType
-        nullptr,                                        // pNext
-        0,                                              // flags
-        (uint32_t)setLayouts.size(),                    // setLayoutCount
-        setLayouts.data(),                              // pSetLayouts
-        0,                                              // pushConstantRangeCount
-        nullptr                                         // pPushConstantRanges
-    };
+        return false;
+    }
 
-    CHECK_VK_RESULT_SUCCESS(vkCreatePipelineLayout(
-        mp_gfxDevice->logicalDevice,   // device
-        &pipelineLayoutCreateInfo,  // pCreateInfo
-        nullptr,                    // pAllocator,
-        &m_pipelineLayout));        // pPipelineLayout
+    destroyImageStream(index);
+    retireChannel(index);
 
-    const VkGraphicsPipelineCreateInfo pipelineCreateInfo =
+    const VkExtent3D extent =
     {
-        VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,    // sType
-        nullptr,                        // pNext
-        0,                              // flags
-        2,                              // stageCount
-        &shaderStageCreateInfo[0],      // pStages
-        &vertexInputStateCreateInfo,    // pVertexInputState
-        &inputAssemblyStateCreateInfo,  // pInputAssemblyState
-        nullptr,                        // pTessellationState
-        &viewportStateCreateInfo,       // pViewportState
-        &rasterizationStateCreateInfo,  // pRasterizationState
-        &multisampleStateCreateInfo,    // pMultisampleState
-        nullptr,                        // pDepthStencilState
-        &colorBlendStateCreateInfo,     // pColorBlendState
-        nullptr,                        // pDynamicState
-        m_pipelineLayout,               // layout
-        m_renderPass,                   // renderPass
-        0,                              // subpass
-        nullptr,                        // basePipelineHandle
-        0                               // basePipelineIndex
+        AudioAnalyzer::c_textureWidth,  // width
+        AudioAnalyzer::c_textureHeight, // height
+        1,                              // depth
     };
 
-    CHECK_VK_RESULT_SUCCESS(vkCreateGraphicsPipelines(
-        mp_gfxDevice->logicalDevice,   // device
-        nullptr,                    // pipelineCache
-        1,                          // createInfoCount
-        &pipelineCreateInfo,        // pCreateInfos
-        nullptr,                    // pAllocator
-        &m_graphicsPipeline));      // pPipelines
+    m_imageSet.images[index].reset(new GpuImage(
+        mp_gfxDevice,
+        extent,
+        VK_IMAGE_VIEW_TYPE_2D,
+        VK_FORMAT_R8_UNORM,
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VkImageLayout::VK_IMAGE_LAYOUT_UNDEFINED,
+        getComponentMapping(1)));
+    m_imageSet.samplers[index] = getChannelSampler(index, VK_IMAGE_VIEW_TYPE_2D, true);
+
+    // analysis results are copied from the analyzer staging buffers, cleared until the first one
+    m_imageSet.dirtyFlags[index] = false;
+    m_imageSet.clears.push_back(m_imageSet.images[index]);
+    m_imageSet.dirty = true;
+    m_imageSet.sampleRates[index] = audioAnalyzer->getSampleRate();
+    m_imageSet.streams[index].reset(audioAnalyzer.release());
+
+    std::cout << "Audio channel (" << m_imageSet.sampleRates[index] << " Hz): "
+        << filename << std::endl;
+
+    return true;
 }
 
-void Renderer::resizeFramebuffer()
+VkSampler Renderer::getChannelSampler(const uint32_t index,
+    const VkImageViewType viewType,
+    const bool audio)
 {
-    mp_gfxResources->waitForIdle();
+    ResourceList& rl = ResourceList::getInstance();
 
-    for (uint32_t idx = 0; idx < m_framebuffers.size(); ++idx)
+    // repeat would show seams between cube faces and wrap the audio spectrum
+    SamplerState state;
+    state.addressMode = (viewType == VK_IMAGE_VIEW_TYPE_CUBE || audio) ?
+        VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE : VK_SAMPLER_ADDRESS_MODE_REPEAT;
+
+    // texture array slots fall back to the entry of the whole array
+    const std::string name = (index < c_channelCount) ? rl.imageFilesForSearch[index]
+        : rl.imageArrayName + std::to_string(index - c_channelCount);
+    auto iter = m_samplerStates.find(name);
+    if (iter == m_samplerStates.end() && index >= c_channelCount)
     {
-        vkDestroyFramebuffer(mp_gfxDevice->logicalDevice,
-            m_framebuffers[idx], nullptr);
+        iter = m_samplerStates.find(rl.imageArrayName);
     }
-    vkDestroyPipelineLayout(mp_gfxDevice->logicalDevice, m_pipelineLayout, nullptr);
-    vkDestroyPipeline(mp_gfxDevice->logicalDevice, m_graphicsPipeline, nullptr);
-
-    createGraphicsPipeline();
-    createFramebuffers();
+    if (iter != m_samplerStates.end())
+    {
+        state = iter->second;
+    }
+    return m_samplerCache->getSampler(state);
 }
 
-void Renderer::createImages()
+void Renderer::loadSamplerStates()
 {
     ResourceList& rl = ResourceList::getInstance();
-    const uint32_t imageCount = (uint32_t)rl.imageFiles.size();
-    m_imageSet.stagingBuffers.resize(imageCount);
-    m_imageSet.images.resize(imageCount);
-    m_imageSet.dirtyFlags.resize(imageCount);
-    for (uint32_t idx = 0; idx < imageCount; ++idx)
+    const std::string filename = rl.imagePath + "/" + rl.samplerFile;
+    m_samplerStates.clear();
+    std::ifstream file(filename);
+    if (!file.is_open())
     {
-        createImage(idx, rl.imagePath + "/" + rl.imageFiles[idx]);
+        return;
+    }
+
+    // "channel0 = nearest clamp" per line, '#' starts a comment,
+    // words in any order: nearest/linear, repeat/mirror/clamp/border,
+    // mip_nearest/mip_linear and a number for the max anisotropy
+    std::string line;
+    uint32_t lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        ++lineNumber;
+        line = line.substr(0, line.find('#'));
+        const size_t separator = line.find('=');
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+        {
+            continue;
+        }
+
+        std::istringstream nameStream(line.substr(0, separator));
+        std::string name;
+        nameStream >> name;
+        std::istringstream valueStream((separator != std::string::npos) ? line.substr(separator + 1) : "");
+        SamplerState state;
+        bool valid = (separator != std::string::npos) && !name.empty();
+        std::string word;
+        while (valid && valueStream >> word)
+        {
+            valid = parseSamplerWord(word, state);
+        }
+        if (!valid)
+        {
+            std::cerr << filename << "(" << lineNumber << "): expected name = sampler state" << std::endl;
+            continue;
+        }
+        m_samplerStates[name] = state;
     }
-    m_imageSet.dirty = true;
 }
 
-void Renderer::createImage(const uint32_t index, const std::string& filename)
+void Renderer::updateSamplers()
 {
-    ImageLoader imgLoader(filename);
-
-    if (imgLoader.getBytesize() > 0)
+    uint32_t channelCount = 0;
+    for (uint32_t idx = 0; idx < m_imageSet.images.size(); ++idx)
     {
-        m_imageSet.stagingBuffers[index].reset(new GpuBufferStaging(
-            mp_gfxDevice,
-            imgLoader.getBytesize(),
-            imgLoader.getData()));
-
-        m_imageSet.images[index].reset(new GpuImage(
-            mp_gfxDevice,
-            std::get<0>(imgLoader.getSize()),
-            std::get<1>(imgLoader.getSize()),
-            VkFormat::VK_FORMAT_R8G8B8A8_SRGB,
-            VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-            VkImageLayout::VK_IMAGE_LAYOUT_UNDEFINED,
-            VK_FILTER_LINEAR,
-            VK_SAMPLER_ADDRESS_MODE_REPEAT));
+        const GpuImage* const p_image = m_imageSet.images[idx].get();
+        if (p_image)
+        {
+            m_imageSet.samplers[idx] = getChannelSampler(idx, p_image->viewType, m_imageSet.sampleRates[idx] > 0);
+            ++channelCount;
+        }
+    }
+    invalidateDescriptorsImage();
+    std::cout << m_samplerCache->getSamplerCount() << " sampler(s) shared by "
+        << channelCount << " channel(s)." << std::endl;
+}
 
-        m_imageSet.dirtyFlags[index] = true;
+void Renderer::destroyImageStream(const uint32_t index)
+{
+    m_imageSet.sampleRates[index] = 0;
+    if (!m_imageSet.streams[index])
+    {
+        return;
     }
+    // frames in flight might copy from the stream staging buffers,
+    // the stream is retired instead of draining the gpu and its slots are not released anymore
+    for (auto&& slotsRef : m_imageSet.streamSlotsInFlight)
+    {
+        slotsRef.erase(std::remove_if(slotsRef.begin(), slotsRef.end(),
+            [index](const std::pair<uint32_t, int32_t>& slot) { return slot.first == index; }),
+            slotsRef.end());
+    }
+    ImageSet::RetiredChannel retired;
+    retired.stream = std::move(m_imageSet.streams[index]);
+    retired.frameCount = (uint32_t)mp_gfxResources->getCmdBuffer()->commandBuffers.size();
+    m_imageSet.retired.emplace_back(std::move(retired));
 }
 
-bool Renderer::createShaders(const bool fromGlsl)
+bool Renderer::createShaders()
 {
     ResourceList& rl = ResourceList::getInstance();
     assert(rl.shaderFiles.size() >= 2);
 
     bool valid = false;
     ShaderFiles shaderFiles;
-    if (fromGlsl)
+    shaderFiles.vertShader = rl.shaderPath + "/" + rl.shaderFiles[0];
+    shaderFiles.fragShader = rl.shaderPath + "/" + rl.shaderFiles[1];
+    shaderFiles.shaderFileTypes = ShaderFiles::ShaderFileTypes::glsl;
+    shaderFiles.defines = getShaderDefines();
+    shaderFiles.optimization = GlobalVariables::getInstance().shaderOptimization;
+    std::unique_ptr<Shader> newShader(new Shader(mp_gfxDevice, shaderFiles, mp_jobSystem));
+    if (newShader->vert != nullptr && newShader->frag != nullptr
+        && isShaderLayoutSupported(newShader->reflection))
     {
-        shaderFiles.vertShader = rl.shaderPath + "/" + rl.shaderFiles[0];
-        shaderFiles.fragShader = rl.shaderPath + "/" + rl.shaderFiles[1];
-        shaderFiles.shaderFileTypes = ShaderFiles::ShaderFileTypes::glsl;
+        m_shader.reset(newShader.release());
+        updateShaderInputs();
+        valid = true;
     }
-    else
+    return valid;
+}
+
+void Renderer::createShaders(const RendererStartup& startup)
+{
+    const std::string defines = getShaderDefines();
+
+    // the startup compile used the defines of the files, which fails if an image did not load
+    if (startup.shaderCode.valid && startup.shaderDefines == defines)
     {
-        shaderFiles.vertShader = rl.shaderPath + "/" + rl.spirvFiles[0];
-        shaderFiles.fragShader = rl.shaderPath + "/" + rl.spirvFiles[1];
-        shaderFiles.shaderFileTypes = ShaderFiles::ShaderFileTypes::spirv;
+        m_shader.reset(new Shader(mp_gfxDevice, startup.shaderCode));
+        if (m_shader->vert == nullptr || m_shader->frag == nullptr
+            || !isShaderLayoutSupported(m_shader->reflection))
+        {
+            m_shader.reset();
+        }
+        else
+        {
+            updateShaderInputs();
+        }
     }
-    std::unique_ptr<Shader> newShader(new Shader(mp_gfxDevice, shaderFiles));
-    if (newShader->vert != nullptr && newShader->frag != nullptr)
+    if (!m_shader)
     {
-        m_shader.reset(newShader.release());
-        valid = true;
+        createShaders();
     }
-    return valid;
 }
 
-void Renderer::updateImages(const std::vector<std::string>& imageNames)
+uint32_t Renderer::getMaxSamplerCount() const
+{
+    // the channels and the texture array are all in the fragment stage and set 1,
+    // the spec only guarantees 16 samplers per stage (iTextures needs 64 + 4)
+    const VkPhysicalDeviceLimits& limits = mp_gfxDevice->physicalDeviceProperties.limits;
+    return std::min({
+        limits.maxPerStageDescriptorSamplers,
+        limits.maxPerStageDescriptorSampledImages,
+        limits.maxDescriptorSetSamplers,
+        limits.maxDescriptorSetSampledImages });
+}
+
+bool Renderer::isShaderLayoutSupported(const ShaderReflection& reflection) const
+{
+    const GfxDescriptorPool* const p_descriptorPool = mp_gfxResources->getDescriptorPool();
+    const uint32_t textureArraySize = (uint32_t)m_imageSet.images.size() - c_channelCount;
+    uint32_t samplerCount = 0;
+    bool supported = true;
+    for (const auto& descriptorRef : reflection.descriptors)
+    {
+        if (descriptorRef.descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+        {
+            samplerCount += descriptorRef.descriptorCount;
+        }
+        // set 0 is the channel uniform, parameter and frame input blocks,
+        // set 1 the channel images and the texture array
+        const bool uniformBlock = descriptorRef.set == 0
+            && descriptorRef.binding < p_descriptorPool->c_bindingCountUniform
+            && descriptorRef.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER
+            && descriptorRef.descriptorCount == 1;
+        const bool channelImage = descriptorRef.set == 1
+            && descriptorRef.binding < p_descriptorPool->c_bindingCountImage
+            && descriptorRef.binding < c_channelCount
+            && descriptorRef.descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER
+            && descriptorRef.descriptorCount == 1;
+        const bool textureArray = descriptorRef.set == 1
+            && descriptorRef.binding == c_textureArrayBinding
+            && descriptorRef.descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER
+            && descriptorRef.descriptorCount <= p_descriptorPool->c_maxTextureArraySize
+            && descriptorRef.descriptorCount <= textureArraySize;
+        if (!uniformBlock && !channelImage && !textureArray)
+        {
+            std::cerr << "Shader resource " << descriptorRef.name << " (set " << descriptorRef.set
+                << ", binding " << descriptorRef.binding << ") is not supported" << std::endl;
+            supported = false;
+        }
+    }
+
+    const uint32_t maxSamplerCount = getMaxSamplerCount();
+    if (samplerCount > maxSamplerCount)
+    {
+        std::cerr << "Shader uses " << samplerCount << " image samplers, the device supports "
+            << maxSamplerCount << " (reduce DEF_TEXTURE_ARRAY_SIZE)" << std::endl;
+        supported = false;
+    }
+
+    const uint32_t deviceMaxPushConstantByteSize =
+        mp_gfxDevice->physicalDeviceProperties.limits.maxPushConstantsSize;
+    const uint32_t maxPushConstantByteSize = (deviceMaxPushConstantByteSize < c_maxPushConstantByteSize) ?
+        deviceMaxPushConstantByteSize : c_maxPushConstantByteSize;
+    if (reflection.pushConstantSize > maxPushConstantByteSize)
+    {
+        std::cerr << "Shader push constants do not fit in "
+            << maxPushConstantByteSize << " bytes" << std::endl;
+        supported = false;
+    }
+    return supported;
+}
+
+void Renderer::updateShaderInputs()
 {
-    mp_gfxResources->waitForIdle(); // no buffering for resources, need to wait
+    const ShaderReflection& reflection = m_shader->reflection;
 
+    auto findInput = [](const std::vector<SpirvBlockMember>& members, const char* const p_name)
+    {
+        ShaderInputMember input;
+        const SpirvBlockMember* const p_member = findBlockMember(members, p_name);
+        if (p_member)
+        {
+            input.offset = p_member->offset;
+            input.size = p_member->size;
+        }
+        return input;
+    };
+
+    // push constants (DEF_PUSH_CONSTANT_INPUTS) or the set 0 binding 2 uniform block
+    const SpirvDescriptor* const p_frameBlock = reflection.findDescriptor(0, 2);
+    const std::vector<SpirvBlockMember>& frameMembers = (reflection.pushConstantSize == 0 && p_frameBlock) ?
+        p_frameBlock->members : reflection.pushConstantMembers;
+    m_shaderInputs.iMouse = findInput(frameMembers, "iMouse");
+    m_shaderInputs.iDate = findInput(frameMembers, "iDate");
+    m_shaderInputs.iResolution = findInput(frameMembers, "iResolution");
+    m_shaderInputs.iChannelTime = findInput(frameMembers, "iChannelTime");
+    m_shaderInputs.globalVariables = findInput(frameMembers, "globalVariables_");
+
+    const SpirvDescriptor* const p_uniformBlock = reflection.findDescriptor(0, 0);
+    m_shaderInputs.iChannelResolution = p_uniformBlock ?
+        findInput(p_uniformBlock->members, "iChannelResolution") : ShaderInputMember();
+}
+
+std::string Renderer::getShaderDefines() const
+{
+    std::string defines = getModeShaderDefines();
+
+    // toy.frag declares 64 textures, fewer if the device can not bind them with the channels
+    const uint32_t maxSamplerCount = getMaxSamplerCount();
+    const uint32_t textureArraySize = (maxSamplerCount > c_channelCount) ? maxSamplerCount - c_channelCount : 1;
+    if (textureArraySize < m_imageSet.images.size() - c_channelCount)
+    {
+        defines += "#define DEF_TEXTURE_ARRAY_SIZE " + std::to_string(textureArraySize) + "\n";
+    }
+    for (uint32_t idx = 0; idx < c_channelCount; ++idx)
+    {
+        // channels which are not loaded are declared by their files
+        const GpuImage* const p_image = m_imageSet.images[idx].get();
+        defines += p_image ?
+            getChannelShaderDefine(idx, p_image->viewType) : getChannelFileShaderDefine(idx);
+    }
+    return defines;
+}
+
+void Renderer::updateImages(const std::vector<std::string>& imageNames)
+{
+    // replaced images are retired and the image sets rewritten per command buffer,
+    // the gpu is only drained for recompiles
     ResourceList& rl = ResourceList::getInstance();
+    const std::string prevDefines = getShaderDefines();
+    std::vector<bool> channelUpdated(rl.imageFilesForSearch.size(), false);
+
+    // the sampler states are read before the channels reload with them
+    if (std::find(imageNames.begin(), imageNames.end(), rl.samplerFile) != imageNames.end())
+    {
+        loadSamplerStates();
+        updateSamplers();
+    }
+
     std::cout << "Texture file(s) changed ( ";
     for (const auto& nameRef : imageNames)
     {
         std::cout << nameRef << " ";
-        std::string compareName = nameRef;
-        const size_t lastIndex = compareName.find_last_of(".");
-        if (lastIndex != std::string::npos)
+
+        // any extension, beginChannel decides which of the channel files is used
+        const auto iter = m_imageFileNames.find(nameRef.substr(0, nameRef.find_last_of(".")));
+        if (iter == m_imageFileNames.end() || !isChannelUsed(iter->second))
+        {
+            // loaded when a shader starts using the channel
+            continue;
+        }
+        const uint32_t idx = iter->second;
+        if (idx >= c_channelCount)
         {
-            compareName = compareName.substr(0, lastIndex);
+            // texture array slots, e.g. texture12.png
+            createImage(idx, { rl.imagePath + "/" + nameRef }, VK_IMAGE_VIEW_TYPE_2D);
+            m_imageSet.dirty = true;
         }
-        for (uint32_t idx = 0; idx < rl.imageFilesForSearch.size(); ++idx)
+        else if (!channelUpdated[idx])
         {
-            if (compareName == rl.imageFilesForSearch[idx])
+            // the same selection as the first load, e.g. a new cube face takes over the 2D image,
+            // the channel is reloaded once even if several of its files changed
+            std::unique_ptr<ImageUpload> upload = beginChannel(idx);
+            if (upload)
             {
-                createImage(idx, rl.imagePath + "/" + nameRef);
-                m_imageSet.dirty = true;
+                endImageUpload(*upload);
             }
+            m_imageSet.dirty = true;
+            channelUpdated[idx] = true;
         }
     }
 
     std::cout << ")." << std::endl;
+
     std::cout << "New image data created." << std::endl;
 
-    createDescriptorsImage();
+    invalidateDescriptorsImage();
+    updateChannelUniforms();
+
+    // sampler types in the shader need to match the image view types
+    if (getShaderDefines() != prevDefines)
+    {
+        std::cout << "Channel image type(s) changed. Compiling shaders..." << std::endl;
+        mp_gfxResources->waitForIdle();
+        if (recompileShaders())
+        {
+            std::cout << "Done." << std::endl;
+        }
+    }
+
+    // channel resolutions and the sample rate can be specialization constants
+    updateSpecialization();
 }
 
 void Renderer::updateShaders(const std::vector<std::string>& shaderNames)
 {
-    mp_gfxResources->waitForIdle(); // no buffering for resources, need to wait
+    // exempt from buffering: a recompile recreates the pipeline, its layouts and the descriptor sets
+    mp_gfxResources->waitForIdle();
 
     std::cout << "Shader file(s) changed ( ";
     for (const auto& shaderNameRef : shaderNames)
@@ -899,18 +3040,38 @@ void Renderer::updateShaders(const std::vector<std::string>& shaderNames)
     }
     std::cout << "). Compiling..." << std::endl;
 
-    const bool valid = createShaders(true);
+    if (recompileShaders())
+    {
+        std::cout << "Done." << std::endl;
+    }
+}
+
+bool Renderer::recompileShaders()
+{
+    // the shader is replaced while a background rebuild might use it
+    cancelPipelineJob();
+
+    const bool valid = createShaders();
 
     if (valid)
     {
         // destroy old before creating new
-        vkDestroyPipelineLayout(mp_gfxDevice->logicalDevice, m_pipelineLayout, nullptr);
-        vkDestroyPipeline(mp_gfxDevice->logicalDevice, m_graphicsPipeline, nullptr);
-
+        destroyGraphicsPipeline();
+
+        // the new shader might use different resources
+        updateChannels();
+        createDescriptorsUniform();
+        updateChannelUniforms();
+        updateParamUniforms();
+        createDescriptorsImage();
         createGraphicsPipeline();
-
-        std::cout << "Done." << std::endl;
     }
+    else
+    {
+        // restart the cancelled rebuild for the old shader
+        updateSpecialization();
+    }
+    return valid;
 }
 
 } // namespace
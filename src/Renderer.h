@@ -4,10 +4,20 @@
 // Copyright (c) 2017 Johannes Pystynen
 // This code is licensed under the MIT license (MIT)
 
+#include "FrameArena.h"
 #include "GfxResources.h"
+#include "ImageLoader.h"
+#include "JobSystem.h"
+#include "SamplerCache.h"
+#include "Shader.h"
+#include "TextureRegistry.h"
 #include "Window.h"
 
+#include <map>
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 #include <cstdint>
 
@@ -22,7 +32,7 @@ class DescriptorSet;
 class GpuBufferUniform;
 class GpuBufferStaging;
 class GpuImage;
-class Shader;
+class ImageStream;
 
 class RendererInput
 {
@@ -36,10 +46,27 @@ public:
     uint32_t frameIndex = 0;
 };
 
+// Renderer startup work which does not need the device,
+// done while the device is being created.
+class RendererStartup
+{
+public:
+    // Compiles the glsl shaders with the sampler defines of the channel files.
+    void compileShaders(JobSystem* const p_jobSystem);
+    void loadPipelineCache();
+
+    std::string shaderDefines;
+    ShaderCode shaderCode;  // not valid if the compile failed
+    std::vector<uint8_t> pipelineCacheData;
+};
+
 class Renderer
 {
 public:
-    Renderer(GfxResources* const p_gfxResources, Window* const p_window);
+    Renderer(GfxResources* const p_gfxResources,
+        Window* const p_window,
+        JobSystem* const p_jobSystem,
+        const RendererStartup& startup);
     ~Renderer();
 
     Renderer(const Renderer&) = delete;
@@ -50,63 +77,300 @@ public:
     void resizeFramebuffer();
     void updateShaders(const std::vector<std::string>& shaderNames);
     void updateImages(const std::vector<std::string>& imageNames);
+    // Rereads the parameter and preset files, no recompile.
+    void updateParams();
+    // Specialization constant values of the preset, a pipeline swap.
+    void selectPreset(const uint32_t presetIndex);
+
+    // Most frame arena bytes a frame has used, for sizing the arena.
+    size_t getFrameArenaHighWaterMark() const;
 
 private:
     const uint32_t c_bufferingCount = 3;
+    const size_t c_frameArenaByteSize = 64 * 1024;
 
     void renderCopyImages(GfxCmdBuffer::CmdBuffer& p_cmdBuffer);
+    // Begins the frame command buffer once, it is only recorded when something needs copying
+    // unless the shader has push constants.
+    void beginCmdBuffer(GfxCmdBuffer::CmdBuffer& cmdBuffer, bool& begun);
+    void renderCopyStreamFrames(GfxCmdBuffer::CmdBuffer& cmdBuffer,
+        const float timeSeconds,
+        bool& cmdBufferBegun);
+    void releaseStreamFrames(const uint32_t cmdBufferIndex);
+    // Destroys the retired channel data which no command buffer uses anymore.
+    void releaseRetiredChannels();
+
+    // Channel image whose layers are decoded to the staging buffer by jobs.
+    struct ImageUpload
+    {
+        uint32_t index                      = 0;
+        VkImageViewType viewType            = VK_IMAGE_VIEW_TYPE_2D;
+        VkFormat format                     = VK_FORMAT_UNDEFINED;
+        ImageComponentType componentType    = ImageComponentType::unorm8;
+        uint32_t channelCount               = 0;
+        VkExtent3D extent                   = { 0, 0, 0 };
+
+        std::vector<std::string> filenames;
+        std::vector<std::unique_ptr<ImageLoader> > imgLoaders;
+        std::unique_ptr<GpuBufferStaging> stagingBuffer;
+        std::vector<uint8_t> decodedLayers; // written by the decode jobs
+        std::vector<JobSystem::JobHandle> decodeJobs;
+
+        // identical content is decoded once, the other channels share the image
+        TextureRegistry::Key textureKey;
+        std::shared_ptr<GpuImage> sharedImage; // already loaded by another channel
+        bool waitForShared = false; // an earlier upload of the batch decodes the content, decoded here if it fails
+    };
 
-    void createImages();
-    void createImage(const uint32_t index, const std::string& filename);
-    bool createShaders(const bool fromGlsl);
-
+    // image set entries are the channels and then the texture array slots
+    static const uint32_t c_channelCount        = 4;
+    static const uint32_t c_textureArrayBinding = 4; // set 1 binding of iTextures
+
+    void createImageSet();
+    // 1x1 transparent black images bound for the used channels and texture array slots without an image,
+    // one per view type a channel can be declared with.
+    void createPlaceholderImage();
+    const GpuImage* getPlaceholderImage(const VkImageViewType viewType) const;
+    // Starts decoding the files of the channels the shader uses,
+    // the uploads are ended with endImageUpload.
+    std::vector<std::unique_ptr<ImageUpload> > beginImages();
+    // Returns nullptr if the channel was loaded without decoding jobs or is not valid.
+    std::unique_ptr<ImageUpload> beginChannel(const uint32_t index);
+    void releaseChannel(const uint32_t index);
+    // Keeps the image and staging buffer of the channel until the frames in flight have finished,
+    // a pending upload of a shared image is handed to a channel still using the image.
+    void retireChannel(const uint32_t index);
+    bool isChannelLoaded(const uint32_t index) const;
+    // True if the shader samples the channel, or declares the texture array slot.
+    bool isChannelUsed(const uint32_t index) const;
+    // Loads the channels the shader started using and releases the unused ones.
+    void updateChannels();
+    // one file for 2D and 3D images, six face files for cube images
+    void createImage(const uint32_t index,
+        const std::vector<std::string>& filenames,
+        const VkImageViewType viewType);
+    // Starts decoding, returns nullptr if the files are not valid.
+    // Files with the content of a loaded image are not decoded, the image is shared.
+    std::unique_ptr<ImageUpload> beginImageUpload(const uint32_t index,
+        const std::vector<std::string>& filenames,
+        const VkImageViewType viewType);
+    // Starts the decode jobs of the upload layers, straight to the mapped staging memory.
+    void beginImageDecode(ImageUpload& upload);
+    // Waits for the decoding and creates the channel image.
+    void endImageUpload(ImageUpload& upload);
+    // Sampler of the sampler file entry of the channel, otherwise the default of the image type.
+    VkSampler getChannelSampler(const uint32_t index, const VkImageViewType viewType, const bool audio);
+    // Reads the sampler file, "name = filter wrap mip anisotropy" per line.
+    void loadSamplerStates();
+    // Swaps the samplers of the loaded channels, no waiting since samplers are never destroyed.
+    void updateSamplers();
+    bool createImageSequence(const uint32_t index);
+    bool createAudioChannel(const uint32_t index, const std::string& filename);
+    void destroyImageStream(const uint32_t index);
+    bool createShaders();
+    void createShaders(const RendererStartup& startup);
+    bool recompileShaders();
+
+    // sampler declaration defines for toy.frag based on the channel image types
+    std::string getShaderDefines() const;
+
+    // Descriptor set layouts are reflected from the shader.
+    // One uniform set per command buffer, each pointing to its own slot of the uniform buffers.
     void createDescriptorsUniform();
+    // Copies the latest uniform blocks to the slot of the command buffer if it is outdated,
+    // called after the fence wait when the command buffer no longer reads the slot.
+    void updateUniformSlot(const uint32_t cmdBufferIndex);
+    // One image set per command buffer, the sets are written by updateDescriptorSetImage.
     void createDescriptorsImage();
+    // Marks the image sets for rewriting, used when channel images change.
+    void invalidateDescriptorsImage();
+    // Writes the current channel images to the set of the command buffer if it is outdated,
+    // called by render() after the command buffer fence wait.
+    void updateDescriptorSetImage(const uint32_t cmdBufferIndex);
     void createRenderPasses();
     void createFramebuffers();
     void createGraphicsPipeline();
+    void createPipelineLayout();
+    // Thread safe, the viewport is set to the extent.
+    VkPipeline createPipeline(const std::vector<uint32_t>& specializationValues,
+        const VkExtent2D extent) const;
+    void destroyGraphicsPipeline();
+
+    // One value per reflected specialization constant: shader defaults,
+    // then the selected preset and the session-constant inputs (DEF_SPECIALIZE_INPUTS).
+    std::vector<uint32_t> getSpecializationValues() const;
+    // Swaps to the cached variant of the values or builds it in a job.
+    void updateSpecialization();
+    // Waits for the variant job and drops its pipeline.
+    void cancelPipelineJob();
+    // Called by render(), swaps to the variant built by the job.
+    void swapSpecializedPipeline();
+    void loadPresets();
+    // Initial data is ignored if it was saved by another device or driver.
+    void createPipelineCache(const std::vector<uint8_t>& initialData);
+    void savePipelineCache();
 
     GfxResources* const mp_gfxResources = nullptr;
     GfxDevice* const mp_gfxDevice       = nullptr;
     Window* const mp_window             = nullptr;
+    JobSystem* const mp_jobSystem       = nullptr;
 
     VkRenderPass m_renderPass           = nullptr;
     VkPipeline m_graphicsPipeline       = nullptr;
     VkPipelineLayout m_pipelineLayout   = nullptr;
+    VkPipelineCache m_pipelineCache     = nullptr;
 
-    struct ShaderInputUniform
-    {
-        float iChannelResolution[4][4];
-        float iMouse[4];
-        float iDate[4];
-        float iResolution[4];
+    // pipelines by specialization values, m_graphicsPipeline is one of these
+    static const uint32_t c_maxPipelineVariants = 8;
+    std::map<std::vector<uint32_t>, VkPipeline> m_pipelineVariants;
+    std::vector<uint32_t> m_specializationValues; // of m_graphicsPipeline
 
-        float iChannelTime[4];
+    // variant built in the background, its cache entry is nullptr until swapped in
+    JobSystem::JobHandle m_pipelineJob;
+    VkPipeline m_pendingPipeline        = nullptr; // written by the job
+    std::vector<uint32_t> m_pendingSpecializationValues;
 
-        float iGlobalDelta;
-        float iGlobalFrame;
-        float iGlobalTime;
-        float iSampleRate;
+    // specialization constant values by name, selected at runtime
+    struct SpecializationPreset
+    {
+        std::string name;
+        std::vector<std::pair<std::string, std::string> > values;
     };
+    std::vector<SpecializationPreset> m_presets;
+    uint32_t m_presetIndex = 0;
 
-    std::unique_ptr<DescriptorSet> m_descriptorSetUniform;
-    std::unique_ptr<GpuBufferUniform> m_gpuBufferUniform;
+    // the spec guarantees 128 bytes of push constants
+    static const uint32_t c_maxPushConstantByteSize = 128;
 
-    std::unique_ptr<DescriptorSet> m_descriptorSetImage;
+    // Location of a shader input in the push constant or uniform block,
+    // not written if the shader does not use it.
+    struct ShaderInputMember
+    {
+        uint32_t offset = ~0u;
+        uint32_t size   = 0;
+    };
+    // Writes up to four floats of the input.
+    static void writeShaderInput(uint8_t* const p_blockData,
+        const ShaderInputMember& member,
+        const float (&values)[4]);
+
+    // shader inputs found by reflection, the names match toy.frag
+    struct ShaderInputs
+    {
+        // per-frame, set 0 binding 2 uniform block or push constants
+        ShaderInputMember iMouse;
+        ShaderInputMember iDate;
+        ShaderInputMember iResolution;
+        ShaderInputMember iChannelTime;
+        ShaderInputMember globalVariables; // delta, frame, time, sample rate
+
+        // changes with the channel images, set 0 binding 0 uniform block
+        ShaderInputMember iChannelResolution;
+    };
+    ShaderInputs m_shaderInputs;
+
+    // True if the renderer has descriptors for everything the shader uses
+    // and the device can bind them.
+    bool isShaderLayoutSupported(const ShaderReflection& reflection) const;
+    // Combined image samplers the fragment stage and set 1 can have.
+    uint32_t getMaxSamplerCount() const;
+    void updateShaderInputs();
+
+    // Descriptor binds of the command buffer slot, push constants and the full screen draw.
+    void recordDrawCommands(VkCommandBuffer commandBuffer,
+        const uint32_t imageIndex,
+        const uint32_t cmdBufferIndex,
+        const uint8_t* const p_pushConstantData);
+    // Re-records the draw command buffers of the slot for every swapchain image,
+    // called after the fence wait of the command buffer.
+    void recordDrawCmdBuffers(const uint32_t cmdBufferIndex);
+    // Marks the draw command buffers of all slots for re-recording, used when the
+    // framebuffers, the pipeline or the descriptor sets they bind change.
+    void invalidateDrawCmdBuffers();
+    void createDrawCmdPools();
+    // Called by createFramebuffers, the swapchain image count might have changed.
+    void allocateDrawCmdBuffers();
+    // The blocks are copied to the slot of each command buffer by updateUniformSlot.
+    void updateChannelUniforms();
+    // sample rate of the first audio channel, 44100 if there is none
+    float getSampleRate() const;
+
+    // User parameters are the members of the set 0 binding 1 uniform block,
+    // values by member name are read from the parameter file.
+    void loadParams();
+    void updateParamUniforms();
+
+    // indexed by command buffer, a slot is only rewritten after its command buffer has finished
+    std::vector<std::unique_ptr<DescriptorSet> > m_descriptorSetsUniform;
+    std::vector<bool> m_uniformSlotDirty;
+    std::unique_ptr<GpuBufferUniform> m_gpuBufferUniform; // nullptr if the shader has no uniform block
+    std::unique_ptr<GpuBufferUniform> m_gpuBufferParams;  // nullptr if the shader has no parameter block
+    std::unique_ptr<GpuBufferUniform> m_gpuBufferFrame;   // nullptr if the frame inputs are push constants
+    std::unordered_map<std::string, std::vector<float> > m_paramValues;
+    std::vector<uint8_t> m_channelUniformData; // latest block for m_gpuBufferUniform
+    std::vector<uint8_t> m_paramUniformData;   // latest block for m_gpuBufferParams
+
+    // indexed by command buffer, a set is only rewritten after its command buffer has finished
+    std::vector<std::unique_ptr<DescriptorSet> > m_descriptorSetsImage;
+    std::vector<bool> m_descriptorSetImageDirty;
 
     std::vector<VkFramebuffer> m_framebuffers;
 
+    // Draw commands recorded once and resubmitted, indexed by command buffer and swapchain image.
+    // Not used if the shader has push constants, their values are recorded every frame.
+    std::vector<VkCommandPool> m_drawCmdPools; // one per command buffer
+    std::vector<std::vector<VkCommandBuffer> > m_drawCmdBuffers;
+    std::vector<bool> m_drawCmdBuffersDirty;
+
+    // outlives the images, retired images keep using their samplers
+    std::unique_ptr<SamplerCache> m_samplerCache;
+    std::unordered_map<std::string, SamplerState> m_samplerStates; // by channel or slot name
+    TextureRegistry m_textureRegistry;
+    std::shared_ptr<GpuImage> m_placeholderImage;
+    std::shared_ptr<GpuImage> m_placeholderCubeImage;
+    std::shared_ptr<GpuImage> m_placeholderVolumeImage;
+    VkSampler m_placeholderSampler = nullptr;
+
     struct ImageSet
     {
         std::vector<std::unique_ptr<GpuBufferStaging> > stagingBuffers;
-        std::vector<std::unique_ptr<GpuImage> > images;
+        // channels with identical files share the image (m_textureRegistry),
+        // only the channel with the staging buffer copies it
+        std::vector<std::shared_ptr<GpuImage> > images;
+        std::vector<VkSampler> samplers; // from m_samplerCache
         std::vector<bool> dirtyFlags;
 
-        bool dirty = false; // some images need copying
+        bool dirty = false; // some images need copying or clearing
+
+        // images created without data, cleared by the next renderCopyImages
+        // so they are never sampled in the undefined layout
+        std::vector<std::shared_ptr<GpuImage> > clears;
+
+        // image sequence and audio channels are copied from the stream staging buffers
+        std::vector<std::unique_ptr<ImageStream> > streams;
+        // (channel index, stream slot) pairs copied by each command buffer
+        std::vector<std::vector<std::pair<uint32_t, int32_t> > > streamSlotsInFlight;
+        // sample rate of audio channels, 0 for others
+        std::vector<uint32_t> sampleRates;
+
+        // replaced channel data which frames in flight might still sample or copy
+        struct RetiredChannel
+        {
+            std::shared_ptr<GpuImage> image;
+            std::unique_ptr<GpuBufferStaging> stagingBuffer;
+            std::unique_ptr<ImageStream> stream;
+            uint32_t frameCount = 0; // command buffer fence waits left
+        };
+        std::vector<RetiredChannel> retired;
     };
     ImageSet m_imageSet;
+    // file name without extension -> image set index, e.g. "channel0_posx" and "texture12"
+    std::unordered_map<std::string, uint32_t> m_imageFileNames;
 
     std::unique_ptr<Shader> m_shader;
+
+    // transient per-frame data, reset at the start of render()
+    FrameArena m_frameArena{ c_frameArenaByteSize };
 };
 
 } // namespace
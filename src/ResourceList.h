@@ -30,9 +30,66 @@ public:
     const std::vector<std::string> imageFilesForSearch
     { "channel0", "channel1", "channel2", "channel3" };
 
+    // cube map channel: six face images, e.g. channel0_px.png ... channel0_nz.png
+    const std::vector<std::string> imageCubeFaceSuffixes
+    { "_px", "_nx", "_py", "_ny", "_pz", "_nz" };
+    // 3D channel: raw volume file, e.g. channel0.vol
+    const std::string imageVolumeExtension { ".vol" };
+    // image sequence channel: numbered frames, e.g. channel0_0000.png, channel0_0001.png, ...
+    const std::vector<std::string> imageSequenceExtensions { ".png", ".jpg" };
+    const uint32_t imageSequenceDigits  = 4;
+    const float imageSequenceFps        = 30.0f;
+    // audio channel: wave file analyzed to a 512x2 spectrum and waveform image, e.g. channel0.wav
+    const std::string audioExtension { ".wav" };
+
+    // texture array (iTextures in toy.frag): texture0.png ... texture63.png, any slot can be empty
+    // (GfxDescriptorPool::c_maxTextureArraySize descriptors)
+    const std::string imageArrayName { "texture" };
+    const uint32_t imageArraySize = 64;
+
+    // sampler state per channel in the texture directory, e.g. "channel0 = nearest clamp"
+    const std::string samplerFile { "samplers.txt" };
+
+    // Returns e.g. channel0_0012 for frame 12.
+    std::string getImageSequenceFrameName(const std::string& channelName, const uint32_t frame) const
+    {
+        std::string number = std::to_string(frame);
+        if (number.size() < imageSequenceDigits)
+        {
+            number.insert(0, imageSequenceDigits - number.size(), '0');
+        }
+        return channelName + "_" + number;
+    }
+
+    // Watch patterns for channel files, cube faces and first sequence frames (any extension).
+    std::vector<std::string> getImageWatchPatterns() const
+    {
+        std::vector<std::string> patterns;
+        for (const auto& nameRef : imageFilesForSearch)
+        {
+            patterns.emplace_back(nameRef + ".*");
+            for (const auto& suffixRef : imageCubeFaceSuffixes)
+            {
+                patterns.emplace_back(nameRef + suffixRef + ".*");
+            }
+            patterns.emplace_back(getImageSequenceFrameName(nameRef, 0) + ".*");
+        }
+        patterns.emplace_back(imageArrayName + "*.*");
+        patterns.emplace_back(samplerFile);
+        return patterns;
+    }
+
     const std::string shaderPath { "shaders" };
     const std::vector<std::string> shaderFiles { "toy.vert", "toy.frag" };
-    const std::vector<std::string> spirvFiles { "toy.vert.spv", "toy.frag.spv" };
+    // any shader source in the shader directory tree triggers a recompile
+    const std::vector<std::string> shaderWatchPatterns { "**/*.vert", "**/*.frag", "**/*.glsl" };
+    // user parameter values in the shader directory, applied without recompiling
+    const std::string paramFile { "params.txt" };
+    // specialization constant presets selected with the number keys
+    const std::string presetFile { "presets.txt" };
+
+    // vulkan pipeline cache saved on exit and loaded on startup
+    const std::string pipelineCacheFile { "pipeline_cache.bin" };
 
 private:
     ResourceList() = default;
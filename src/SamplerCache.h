@@ -0,0 +1,126 @@
+#ifndef CORE_SAMPLER_CACHE_H
+#define CORE_SAMPLER_CACHE_H
+
+// Copyright (c) 2017 Johannes Pystynen
+// This code is licensed under the MIT license (MIT)
+
+#include "GfxResources.h"
+
+#include <assert.h>
+#include <cstdint>
+#include <map>
+#include <tuple>
+
+#include <vulkan/vulkan.h>
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace core
+{
+
+// Full sampler state of a channel, the same filter is used for magnification and minification
+// and the same address mode for all coordinates.
+struct SamplerState
+{
+    VkFilter filter                     = VK_FILTER_LINEAR;
+    VkSamplerMipmapMode mipmapMode      = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    VkSamplerAddressMode addressMode    = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    float maxAnisotropy                 = 1.0f; // 1 is no anisotropic filtering
+
+    bool operator<(const SamplerState& other) const
+    {
+        return std::tie(filter, mipmapMode, addressMode, maxAnisotropy)
+            < std::tie(other.filter, other.mipmapMode, other.addressMode, other.maxAnisotropy);
+    }
+};
+
+// One sampler per distinct state, shared by the images.
+// There are only a few possible states so samplers are kept until the cache is destroyed,
+// a sampler handed out is valid for retired images and frames in flight.
+class SamplerCache
+{
+public:
+    explicit SamplerCache(GfxDevice* const p_device)
+        : mp_device(p_device)
+    {
+        assert(mp_device);
+    }
+
+    ~SamplerCache()
+    {
+        if (mp_device->logicalDevice)
+        {
+            for (const auto& samplerRef : m_samplers)
+            {
+                vkDestroySampler(mp_device->logicalDevice, samplerRef.second, nullptr);
+            }
+        }
+    }
+
+    SamplerCache(const SamplerCache&) = delete;
+    SamplerCache& operator=(const SamplerCache&) = delete;
+
+    // Creates the sampler on first use, anisotropy is clamped to what the device supports.
+    VkSampler getSampler(const SamplerState& samplerState)
+    {
+        SamplerState state = samplerState;
+        const float deviceMaxAnisotropy = mp_device->physicalDeviceFeatures.samplerAnisotropy ?
+            mp_device->physicalDeviceProperties.limits.maxSamplerAnisotropy : 1.0f;
+        state.maxAnisotropy = (state.maxAnisotropy < 1.0f) ? 1.0f : state.maxAnisotropy;
+        state.maxAnisotropy = (state.maxAnisotropy > deviceMaxAnisotropy) ?
+            deviceMaxAnisotropy : state.maxAnisotropy;
+
+        const auto iter = m_samplers.find(state);
+        if (iter != m_samplers.end())
+        {
+            return iter->second;
+        }
+
+        const VkSamplerCreateInfo samplerCreateInfo =
+        {
+            VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,  // sType
+            nullptr,                                // pNext
+            0,                                      // flags
+            state.filter,                           // magFilter
+            state.filter,                           // minFilter
+            state.mipmapMode,                       // mipmapMode
+            state.addressMode,                      // addressModeU
+            state.addressMode,                      // addressModeV
+            state.addressMode,                      // addressModeW
+            0.0f,                                   // mipLodBias
+            state.maxAnisotropy > 1.0f,             // anisotropyEnable
+            state.maxAnisotropy,                    // maxAnisotropy
+            false,                                  // compareEnable
+            VK_COMPARE_OP_NEVER,                    // compareOp
+            0.0f,                                   // minLod
+            VK_LOD_CLAMP_NONE,                      // maxLod
+            VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK,// borderColor
+            false                                   // unnormalizedCoordinates
+        };
+
+        VkSampler sampler = nullptr;
+        CHECK_VK_RESULT_SUCCESS(vkCreateSampler(
+            mp_device->logicalDevice,   // device
+            &samplerCreateInfo,         // pCreateInfo
+            nullptr,                    // pAllocator
+            &sampler));                 // pSampler
+
+        m_samplers[state] = sampler;
+        return sampler;
+    }
+
+    uint32_t getSamplerCount() const
+    {
+        return (uint32_t)m_samplers.size();
+    }
+
+private:
+    GfxDevice* const mp_device = nullptr;
+    std::map<SamplerState, VkSampler> m_samplers;
+};
+
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif // CORE_SAMPLER_CACHE_H
@@ -4,6 +4,7 @@
 #include "Shader.h"
 
 #include "GfxResources.h"
+#include "JobSystem.h"
 #include "ShaderCompiler.h"
 
 #include <cstdint>
@@ -18,12 +19,9 @@
 namespace core
 {
 
-static VkShaderModule createShaderModule(
-    GfxDevice* p_gfxDevice,
-    const std::string& shaderFile)
+static std::vector<uint32_t> loadSpirvFile(const std::string& shaderFile)
 {
-    assert(p_gfxDevice);
-    VkShaderModule shaderModule = nullptr;
+    std::vector<uint32_t> code;
 
     std::ifstream file(shaderFile, std::ios::ate | std::ios::binary);
     assert(file.is_open() && "Spirv file not found. Correct working dir?");
@@ -31,50 +29,31 @@ static VkShaderModule createShaderModule(
     if (file.is_open())
     {
         const size_t fileSize = file.tellg();
-        std::vector<char> binaryShader(fileSize);
+        code.resize(fileSize / sizeof(uint32_t));
         file.seekg(0);
-        file.read(binaryShader.data(), fileSize);
+        file.read(reinterpret_cast<char*>(code.data()), code.size()*sizeof(uint32_t));
         file.close();
-
-        const VkShaderModuleCreateInfo shaderModuleCreateInfo =
-        {
-            VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,// sType
-            nullptr,                                    // pNext
-            0,                                          // flags
-            binaryShader.size(),                        // codeSize
-            (uint32_t*)(binaryShader.data())            // pCode
-        };
-
-        CHECK_VK_RESULT_SUCCESS(vkCreateShaderModule(
-            p_gfxDevice->logicalDevice, // device
-            &shaderModuleCreateInfo,    // pCreateInfo
-            nullptr,                    // pAllocator
-            &shaderModule));            // pShaderModule
     }
 
-    return shaderModule;
+    return code;
 }
 
-static VkShaderModule createShaderModuleFromGlsl(
+static VkShaderModule createShaderModuleFromCode(
     GfxDevice* p_gfxDevice,
-    const std::string& shaderFile,
-    const VkShaderStageFlagBits shaderStage)
+    const std::vector<uint32_t>& code)
 {
     assert(p_gfxDevice);
     VkShaderModule shaderModule = nullptr;
 
-    ShaderCompiler shaderCompiler(p_gfxDevice);
-    ShaderCompiler::ShaderCompileData scd =
-        std::move(shaderCompiler.compileShader(shaderFile, shaderStage));
-    if (scd.valid)
+    if (!code.empty())
     {
         const VkShaderModuleCreateInfo shaderModuleCreateInfo =
         {
             VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,// sType
             nullptr,                                    // pNext
             0,                                          // flags
-            scd.data.size()*sizeof(uint32_t),           // codeSize
-            (uint32_t*)(scd.data.data())                // pCode
+            code.size()*sizeof(uint32_t),               // codeSize
+            code.data()                                 // pCode
         };
 
         CHECK_VK_RESULT_SUCCESS(vkCreateShaderModule(
@@ -90,25 +69,80 @@ static VkShaderModule createShaderModuleFromGlsl(
 ///////////////////////////////////////////////////////////////////////////////
 
 Shader::Shader(GfxDevice* const p_gfxDevice,
-    const ShaderFiles& shaderFiles)
+    const ShaderFiles& shaderFiles,
+    JobSystem* const p_jobSystem)
     : mp_gfxDevice(p_gfxDevice)
 {
     assert(mp_gfxDevice);
+    assert(p_jobSystem);
 
     if (shaderFiles.shaderFileTypes == ShaderFiles::ShaderFileTypes::glsl)
     {
-        vert = createShaderModuleFromGlsl(mp_gfxDevice,
-            shaderFiles.vertShader, VK_SHADER_STAGE_VERTEX_BIT);
-        frag = createShaderModuleFromGlsl(mp_gfxDevice,
-            shaderFiles.fragShader, VK_SHADER_STAGE_FRAGMENT_BIT);
+        const ShaderCode shaderCode = compileGlsl(shaderFiles, p_jobSystem);
+        if (shaderCode.valid)
+        {
+            create(shaderCode);
+        }
     }
     else
     {
-        vert = createShaderModule(mp_gfxDevice, shaderFiles.vertShader);
-        frag = createShaderModule(mp_gfxDevice, shaderFiles.fragShader);
+        ShaderCode shaderCode;
+        shaderCode.vert = loadSpirvFile(shaderFiles.vertShader);
+        shaderCode.frag = loadSpirvFile(shaderFiles.fragShader);
+        create(shaderCode);
     }
 }
 
+Shader::Shader(GfxDevice* const p_gfxDevice, const ShaderCode& shaderCode)
+    : mp_gfxDevice(p_gfxDevice)
+{
+    assert(mp_gfxDevice);
+    assert(shaderCode.valid);
+
+    create(shaderCode);
+}
+
+void Shader::create(const ShaderCode& shaderCode)
+{
+    // modules are not created from code that reflection does not understand
+    if (!reflection.addStage(shaderCode.vert, VK_SHADER_STAGE_VERTEX_BIT) ||
+        !reflection.addStage(shaderCode.frag, VK_SHADER_STAGE_FRAGMENT_BIT))
+    {
+        return;
+    }
+
+    vert = createShaderModuleFromCode(mp_gfxDevice, shaderCode.vert);
+    frag = createShaderModuleFromCode(mp_gfxDevice, shaderCode.frag);
+}
+
+ShaderCode Shader::compileGlsl(const ShaderFiles& shaderFiles, JobSystem* const p_jobSystem)
+{
+    assert(shaderFiles.shaderFileTypes == ShaderFiles::ShaderFileTypes::glsl);
+    assert(p_jobSystem);
+
+    ShaderCode shaderCode;
+
+    // glslang keeps its compile state per thread
+    ShaderCompiler::ShaderCompileData vertData;
+    const JobSystem::JobHandle vertJob = p_jobSystem->run([&shaderFiles, &vertData]()
+    {
+        ShaderCompiler shaderCompiler;
+        vertData = std::move(shaderCompiler.compileShader(
+            shaderFiles.vertShader, VK_SHADER_STAGE_VERTEX_BIT, shaderFiles.defines,
+            shaderFiles.optimization));
+    });
+    ShaderCompiler shaderCompiler;
+    ShaderCompiler::ShaderCompileData fragData = std::move(shaderCompiler.compileShader(
+        shaderFiles.fragShader, VK_SHADER_STAGE_FRAGMENT_BIT, shaderFiles.defines,
+        shaderFiles.optimization));
+    p_jobSystem->wait(vertJob);
+
+    shaderCode.valid = vertData.valid && fragData.valid;
+    shaderCode.vert = std::move(vertData.data);
+    shaderCode.frag = std::move(fragData.data);
+    return shaderCode;
+}
+
 Shader::~Shader()
 {
     if (mp_gfxDevice)
@@ -4,7 +4,12 @@
 // Copyright (c) 2017 Johannes Pystynen
 // This code is licensed under the MIT license (MIT)
 
+#include "ShaderCompiler.h"
+#include "SpirvReflection.h"
+
+#include <cstdint>
 #include <string>
+#include <vector>
 
 #include <vulkan/vulkan.h>
 
@@ -14,6 +19,7 @@ namespace core
 {
 
 class GfxDevice;
+class JobSystem;
 
 struct ShaderFiles
 {
@@ -26,12 +32,32 @@ struct ShaderFiles
         glsl = 1,
     };
     ShaderFileTypes shaderFileTypes = ShaderFileTypes::spirv;
+
+    // glsl preamble (e.g. "#define DEF_CHANNEL0_CUBE 1\n"), not used with spirv
+    std::string defines;
+    // spirv-tools passes run after compiling glsl
+    ShaderOptimization optimization = ShaderOptimization::performance;
+};
+
+// Spir-v of the stages compiled from glsl.
+struct ShaderCode
+{
+    std::vector<uint32_t> vert;
+    std::vector<uint32_t> frag;
+    bool valid = false;
 };
 
 class Shader
 {
 public:
-    Shader(GfxDevice* const p_gfxDevice, const ShaderFiles& shaderFiles);
+    // glsl stages are compiled in parallel with the job system
+    Shader(GfxDevice* const p_gfxDevice,
+        const ShaderFiles& shaderFiles,
+        JobSystem* const p_jobSystem);
+    Shader(GfxDevice* const p_gfxDevice, const ShaderCode& shaderCode);
+
+    // Compiles glsl shader files, does not need the device.
+    static ShaderCode compileGlsl(const ShaderFiles& shaderFiles, JobSystem* const p_jobSystem);
     ~Shader();
 
     Shader(const Shader&) = delete;
@@ -39,7 +65,13 @@ public:
 
     VkShaderModule vert = nullptr;
     VkShaderModule frag = nullptr;
+
+    // resources used by the stages, pipeline layout is built from these
+    ShaderReflection reflection;
 private:
+    // Creates the modules and reflects the stages.
+    void create(const ShaderCode& shaderCode);
+
     GfxDevice* const mp_gfxDevice = nullptr;
 };
 
@@ -3,29 +3,30 @@
 
 #include "ShaderCompiler.h"
 
-#include "GfxResources.h"
-
 #include <cstdint>
 #include <assert.h>
 #include <string>
 #include <vector>
 #include <iostream>
 #include <fstream>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
 
 #include <vulkan/vulkan.h>
 #include "glslang/glslang/Public/ShaderLang.h"
 #include "glslang/SPIRV/GlslangToSpv.h"
+#include "spirv-tools/optimizer.hpp"
 
 ///////////////////////////////////////////////////////////////////////////////
 
 namespace core
 {
 
-static TBuiltInResource initResources(
-    GfxDevice* const /*p_gfxDevice*/)
+// Fixed limits, the compiler does not depend on the device
+// so shaders can be compiled before the device is created.
+static TBuiltInResource initResources()
 {
-    // to get device specific limits
-    //VkPhysicalDeviceLimits& limits = p_gfxDevice->physicalDeviceProperties.limits;
 
     TBuiltInResource resources{};
     resources.maxLights                                 = 32;
@@ -140,17 +141,18 @@ static EShLanguage vkStageToEsh(const VkShaderStageFlagBits shaderStage)
 }
 
 static bool glslToSpv(
-    GfxDevice* p_gfxDevice,
     const std::string& glslShaderStr,
     const VkShaderStageFlagBits shaderStage,
+    const std::string& defines,
     std::vector<uint32_t>& spirv)
 {
-    TBuiltInResource resources = std::move(initResources(p_gfxDevice));
+    TBuiltInResource resources = initResources();
 
     const EShLanguage stage = vkStageToEsh(shaderStage);
     glslang::TShader shader(stage);
     std::vector<const char*> shaderStrings {glslShaderStr.c_str()};
     shader.setStrings(shaderStrings.data(), 1);
+    shader.setPreamble(defines.c_str());
 
     // enable spirv and vulkan rules
     constexpr EShMessages messages = (EShMessages)(EShMsgSpvRules | EShMsgVulkanRules);
@@ -184,22 +186,185 @@ static bool glslToSpv(
     return true;
 }
 
-ShaderCompiler::ShaderCompiler(GfxDevice* const p_gfxDevice)
-    : mp_gfxDevice(p_gfxDevice)
+// Instructions after the five word header, the word count is in the high half.
+static uint32_t getSpirvInstructionCount(const std::vector<uint32_t>& spirv)
+{
+    uint32_t count = 0;
+    size_t idx = 5;
+    while (idx < spirv.size())
+    {
+        const uint32_t wordCount = spirv[idx] >> 16;
+        if (wordCount == 0)
+        {
+            break;
+        }
+        idx += wordCount;
+        ++count;
+    }
+    return count;
+}
+
+static const char* getOptimizationName(const ShaderOptimization optimization)
+{
+    switch (optimization)
+    {
+    case ShaderOptimization::size:
+        return "size";
+    case ShaderOptimization::performance:
+        return "performance";
+    default:
+        return "none";
+    }
+}
+
+// Optimized modules shared by all compiler instances, the compile jobs run on any thread.
+class OptimizedSpirvCache
+{
+public:
+    static OptimizedSpirvCache& getInstance()
+    {
+        static OptimizedSpirvCache instance;
+        return instance;
+    }
+
+    bool find(const std::vector<uint32_t>& spirv,
+        const ShaderOptimization optimization,
+        std::vector<uint32_t>& optimized)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const auto iter = m_entries.find(getKey(spirv, optimization));
+        if (iter == m_entries.end() || iter->second.spirv != spirv)
+        {
+            return false;
+        }
+        optimized = iter->second.optimized;
+        return true;
+    }
+
+    void add(const std::vector<uint32_t>& spirv,
+        const ShaderOptimization optimization,
+        const std::vector<uint32_t>& optimized)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // edited shaders do not come back often, old entries are dropped at once
+        if (m_entries.size() >= c_maxEntryCount)
+        {
+            m_entries.clear();
+        }
+        Entry& entry = m_entries[getKey(spirv, optimization)];
+        entry.spirv = spirv;
+        entry.optimized = optimized;
+    }
+
+private:
+    static const uint32_t c_maxEntryCount = 32;
+
+    // FNV-1a of the words and the optimization level
+    static uint64_t getKey(const std::vector<uint32_t>& spirv, const ShaderOptimization optimization)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        hash = (hash ^ (uint64_t)optimization) * 1099511628211ull;
+        for (const uint32_t word : spirv)
+        {
+            hash = (hash ^ word) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    struct Entry
+    {
+        std::vector<uint32_t> spirv; // compared on lookup, hashes might collide
+        std::vector<uint32_t> optimized;
+    };
+    std::unordered_map<uint64_t, Entry> m_entries;
+    std::mutex m_mutex;
+};
+
+// Runs the spirv-tools passes of the level, the input is kept if the optimizer fails.
+static void optimizeSpv(
+    const std::string& shaderFile,
+    const ShaderOptimization optimization,
+    std::vector<uint32_t>& spirv)
+{
+    if (optimization == ShaderOptimization::none)
+    {
+        return;
+    }
+
+    std::vector<uint32_t> optimized;
+    const bool cached = OptimizedSpirvCache::getInstance().find(spirv, optimization, optimized);
+    if (!cached)
+    {
+        spvtools::Optimizer optimizer(SPV_ENV_VULKAN_1_0);
+        optimizer.SetMessageConsumer([&shaderFile](spv_message_level_t level,
+            const char* /*source*/,
+            const spv_position_t& /*position*/,
+            const char* message)
+        {
+            if (level <= SPV_MSG_ERROR)
+            {
+                std::cerr << shaderFile << ": " << message << std::endl;
+            }
+        });
+        if (optimization == ShaderOptimization::size)
+        {
+            optimizer.RegisterSizePasses();
+        }
+        else
+        {
+            optimizer.RegisterPerformancePasses();
+        }
+
+        if (!optimizer.Run(spirv.data(), spirv.size(), &optimized))
+        {
+            std::cerr << shaderFile << ": spir-v optimization failed, using unoptimized code" << std::endl;
+            return;
+        }
+        OptimizedSpirvCache::getInstance().add(spirv, optimization, optimized);
+    }
+
+    // one write, stages are compiled in parallel
+    std::ostringstream report;
+    report << shaderFile << " optimized for " << getOptimizationName(optimization)
+        << (cached ? " (cached): " : ": ")
+        << getSpirvInstructionCount(spirv) << " -> " << getSpirvInstructionCount(optimized)
+        << " instructions, " << spirv.size() * sizeof(uint32_t)
+        << " -> " << optimized.size() * sizeof(uint32_t) << " bytes\n";
+    std::cout << report.str();
+
+    spirv = std::move(optimized);
+}
+
+static void printSpirvCost(const std::string& shaderFile, const SpirvCost& cost)
 {
-    assert(p_gfxDevice);
+    std::ostringstream report;
+    report << shaderFile << " cost: "
+        << cost.aluCount << " alu, "
+        << cost.transcendentalCount << " transcendental, "
+        << cost.textureSampleCount << " texture samples, "
+        << cost.branchCount << " branches, "
+        << cost.loopCount << " loops, ~"
+        << cost.peakLiveScalarCount << " live scalars, "
+        << cost.byteSize << " bytes\n";
+    std::cout << report.str();
+}
 
+// the glslang init and finalize are not thread safe, they are only called once
+ShaderCompilerProcess::ShaderCompilerProcess()
+{
     glslang::InitializeProcess();
 }
 
-ShaderCompiler::~ShaderCompiler()
+ShaderCompilerProcess::~ShaderCompilerProcess()
 {
     glslang::FinalizeProcess();
 }
 
 ShaderCompiler::ShaderCompileData ShaderCompiler::compileShader(
     const std::string& shaderFile,
-    const VkShaderStageFlagBits shaderStage)
+    const VkShaderStageFlagBits shaderStage,
+    const std::string& defines,
+    const ShaderOptimization optimization)
 {
     std::ifstream file(shaderFile, std::ios::in);
     assert(file.is_open() && "Shader file not found. Correct working dir set?");
@@ -214,10 +379,16 @@ ShaderCompiler::ShaderCompileData ShaderCompiler::compileShader(
         file.close();
 
         scd.valid = glslToSpv(
-            mp_gfxDevice,
             strShader,
             shaderStage,
+            defines,
             scd.data);
+        if (scd.valid)
+        {
+            optimizeSpv(shaderFile, optimization, scd.data);
+            scd.cost = getSpirvCost(scd.data);
+            printSpirvCost(shaderFile, scd.cost);
+        }
     }
 
     return scd;
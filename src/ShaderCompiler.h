@@ -4,6 +4,8 @@
 // Copyright (c) 2017 Johannes Pystynen
 // This code is licensed under the MIT license (MIT)
 
+#include "SpirvReflection.h"
+
 #include <cstdint>
 #include <string>
 #include <vector>
@@ -15,8 +17,29 @@
 namespace core
 {
 
-class GfxDevice;
+// spirv-tools optimizer passes run on the glslang output
+enum class ShaderOptimization : uint32_t
+{
+    none        = 0,
+    size        = 1,
+    performance = 2,
+};
 
+// glslang process state: create one before the first compile and destroy it
+// after the last, compilers on several threads share it (Engine owns it).
+class ShaderCompilerProcess
+{
+public:
+    ShaderCompilerProcess();
+    ~ShaderCompilerProcess();
+
+    ShaderCompilerProcess(const ShaderCompilerProcess&) = delete;
+    ShaderCompilerProcess& operator=(const ShaderCompilerProcess&) = delete;
+};
+
+// Glsl to spir-v compiler, can be used on any thread while a ShaderCompilerProcess exists.
+// Optimized modules are cached by the unoptimized spir-v,
+// a stage which compiles to the same code is not optimized again.
 class ShaderCompiler
 {
 public:
@@ -24,20 +47,23 @@ public:
     {
         std::vector<uint32_t> data;
         bool valid = false;
+        SpirvCost cost; // of the optimized code
     };
 
-    ShaderCompiler(GfxDevice* const p_gfxDevice);
-    ~ShaderCompiler();
+    ShaderCompiler() = default;
+    ~ShaderCompiler() = default;
 
     ShaderCompiler(const ShaderCompiler&) = delete;
     ShaderCompiler& operator=(const ShaderCompiler&) = delete;
 
+    // defines: glsl preamble which is inserted after the #version line
+    // Instruction counts and module sizes before and after optimization are printed,
+    // followed by the static cost estimate of the final code.
     ShaderCompileData compileShader(
         const std::string& shaderFile,
-        const VkShaderStageFlagBits shaderStage);
-
-private:
-    GfxDevice* const mp_gfxDevice = nullptr;
+        const VkShaderStageFlagBits shaderStage,
+        const std::string& defines,
+        const ShaderOptimization optimization);
 };
 
 } // namespace
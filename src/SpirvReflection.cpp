@@ -0,0 +1,800 @@
+// Copyright (c) 2017 Johannes Pystynen
+// This code is licensed under the MIT license (MIT)
+
+#include "SpirvReflection.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace core
+{
+
+// the subset of spir-v needed for resource reflection and cost estimates
+static const uint32_t s_spirvMagic = 0x07230203;
+static const uint32_t s_spirvHeaderWordCount = 5;
+
+enum SpirvOp : uint32_t
+{
+    OpName              = 5,
+    OpMemberName        = 6,
+    OpExtInstImport     = 11,
+    OpExtInst           = 12,
+    OpTypeBool          = 20,
+    OpTypeInt           = 21,
+    OpTypeFloat         = 22,
+    OpTypeVector        = 23,
+    OpTypeMatrix        = 24,
+    OpTypeImage         = 25,
+    OpTypeSampler       = 26,
+    OpTypeSampledImage  = 27,
+    OpTypeArray         = 28,
+    OpTypeRuntimeArray  = 29,
+    OpTypeStruct        = 30,
+    OpTypePointer       = 32,
+    OpConstant          = 43,
+    OpSpecConstantTrue  = 48,
+    OpSpecConstantFalse = 49,
+    OpSpecConstant      = 50,
+    OpFunction          = 54,
+    OpVariable          = 59,
+    OpLoad              = 61,
+    OpDecorate          = 71,
+    OpMemberDecorate    = 72,
+    OpVectorShuffle     = 79,
+    OpCompositeConstruct = 80,
+    OpCompositeExtract  = 81,
+    OpCompositeInsert   = 82,
+    OpImageSampleImplicitLod = 87,  // first sample op
+    OpImageRead         = 98,       // last sample, fetch and gather op
+    OpConvertFToU       = 109,      // first conversion op
+    OpBitcast           = 124,      // last conversion op
+    OpSNegate           = 126,      // first arithmetic op
+    OpSMulExtended      = 152,      // last arithmetic op
+    OpAny               = 154,      // first relational and logical op
+    OpFUnordGreaterThanEqual = 191, // last relational and logical op
+    OpShiftRightLogical = 194,      // first bit op
+    OpBitCount          = 205,      // last bit op
+    OpDPdx              = 207,      // first derivative op
+    OpFwidthCoarse      = 215,      // last derivative op
+    OpPhi               = 245,
+    OpLoopMerge         = 246,
+    OpBranchConditional = 250,
+    OpSwitch            = 251,
+};
+
+// GLSL.std.450 extended instructions Sin to InverseSqrt
+static const uint32_t s_glslStd450TranscendentalFirst = 13;
+static const uint32_t s_glslStd450TranscendentalLast = 32;
+
+enum SpirvDecoration : uint32_t
+{
+    DecorationSpecId        = 1,
+    DecorationBlock         = 2,
+    DecorationBufferBlock   = 3,
+    DecorationArrayStride   = 6,
+    DecorationMatrixStride  = 7,
+    DecorationBinding       = 33,
+    DecorationDescriptorSet = 34,
+    DecorationOffset        = 35,
+};
+
+enum SpirvStorageClass : uint32_t
+{
+    StorageClassUniformConstant = 0,
+    StorageClassUniform         = 2,
+    StorageClassPushConstant    = 9,
+    StorageClassStorageBuffer   = 12,
+};
+
+static const uint32_t s_spirvDimBuffer = 5;
+
+// View type matching the image dimension (Dim operand) of an OpTypeImage.
+static VkImageViewType getImageViewType(const uint32_t dim, const bool arrayed)
+{
+    switch (dim)
+    {
+    case 0: return arrayed ? VK_IMAGE_VIEW_TYPE_1D_ARRAY : VK_IMAGE_VIEW_TYPE_1D;
+    case 2: return VK_IMAGE_VIEW_TYPE_3D;
+    case 3: return arrayed ? VK_IMAGE_VIEW_TYPE_CUBE_ARRAY : VK_IMAGE_VIEW_TYPE_CUBE;
+    default: return arrayed ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
+    }
+}
+
+namespace
+{
+
+struct SpirvId
+{
+    uint32_t opcode = 0;
+    std::vector<uint32_t> operands; // words after the result id
+
+    std::string name;
+    std::vector<std::string> memberNames;
+    std::vector<uint32_t> memberOffsets;
+    std::vector<uint32_t> memberMatrixStrides;
+
+    uint32_t set            = 0;
+    uint32_t binding        = 0;
+    uint32_t arrayStride    = 0;
+    uint32_t specId         = ~0u;
+    bool block              = false;
+    bool bufferBlock        = false;
+};
+
+class SpirvModule
+{
+public:
+    explicit SpirvModule(const std::vector<uint32_t>& code)
+    {
+        if (code.size() < s_spirvHeaderWordCount || code[0] != s_spirvMagic)
+        {
+            return;
+        }
+        ids.resize(code[3]); // id bound
+
+        size_t wordIndex = s_spirvHeaderWordCount;
+        bool inFunctions = false;
+        while (wordIndex < code.size())
+        {
+            const uint32_t opcode = code[wordIndex] & 0xffff;
+            const uint32_t wordCount = code[wordIndex] >> 16;
+            if (wordCount == 0 || wordIndex + wordCount > code.size())
+            {
+                return;
+            }
+            const uint32_t* const p_words = &code[wordIndex + 1];
+            const uint32_t operandCount = wordCount - 1;
+
+            if (opcode == OpFunction)
+            {
+                inFunctions = true;
+            }
+            if (inFunctions)
+            {
+                // any operand naming a variable counts as a use
+                // (a literal with the same value only keeps an unused binding)
+                for (uint32_t idx = 0; idx < operandCount; ++idx)
+                {
+                    referencedIds.insert(p_words[idx]);
+                }
+            }
+            else if (!parseDeclaration(opcode, p_words, operandCount))
+            {
+                return;
+            }
+            wordIndex += wordCount;
+        }
+        valid = true;
+    }
+
+    // Byte size of a type in a block.
+    uint32_t getSize(const uint32_t typeId, const uint32_t matrixStride = 0) const
+    {
+        if (typeId >= ids.size())
+        {
+            return 0;
+        }
+        const SpirvId& type = ids[typeId];
+        switch (type.opcode)
+        {
+        case OpTypeInt:
+        case OpTypeFloat:
+            return type.operands[0] / 8;
+        case OpTypeVector:
+            return type.operands[1] * getSize(type.operands[0]);
+        case OpTypeMatrix:
+            return type.operands[1] * (matrixStride > 0 ? matrixStride : getSize(type.operands[0]));
+        case OpTypeArray:
+        {
+            const uint32_t length = getConstant(type.operands[1]);
+            const uint32_t stride = type.arrayStride > 0 ? type.arrayStride : getSize(type.operands[0]);
+            return length * stride;
+        }
+        case OpTypeStruct:
+        {
+            uint32_t size = 0;
+            for (uint32_t idx = 0; idx < type.operands.size(); ++idx)
+            {
+                size = std::max(size, getMemberOffset(type, idx)
+                    + getSize(type.operands[idx], getMemberMatrixStride(type, idx)));
+            }
+            return size;
+        }
+        default:
+            return 0;
+        }
+    }
+
+    // 32-bit components of a numeric type, 0 for other types
+    uint32_t getComponentCount(const uint32_t typeId) const
+    {
+        if (typeId >= ids.size())
+        {
+            return 0;
+        }
+        const SpirvId& type = ids[typeId];
+        switch (type.opcode)
+        {
+        case OpTypeBool:
+            return 1;
+        case OpTypeInt:
+        case OpTypeFloat:
+            return std::max(type.operands[0] / 32, 1u);
+        case OpTypeVector:
+        case OpTypeMatrix:
+            return type.operands[1] * getComponentCount(type.operands[0]);
+        default:
+            return 0;
+        }
+    }
+
+    uint32_t getConstant(const uint32_t id) const
+    {
+        // operands: result type, value
+        if (id < ids.size() && ids[id].opcode == OpConstant && ids[id].operands.size() >= 2)
+        {
+            return ids[id].operands[1];
+        }
+        return 1;
+    }
+
+    static uint32_t getMemberOffset(const SpirvId& type, const uint32_t member)
+    {
+        return (member < type.memberOffsets.size()) ? type.memberOffsets[member] : 0;
+    }
+
+    static uint32_t getMemberMatrixStride(const SpirvId& type, const uint32_t member)
+    {
+        return (member < type.memberMatrixStrides.size()) ? type.memberMatrixStrides[member] : 0;
+    }
+
+    void setMemberType(SpirvBlockMember& member, const uint32_t typeId) const
+    {
+        // array operands: element type, length
+        uint32_t elementId = typeId;
+        if (isValidId(typeId) && ids[typeId].opcode == OpTypeArray && ids[typeId].operands.size() >= 2)
+        {
+            const SpirvId& array = ids[typeId];
+            elementId = array.operands[0];
+            member.arrayLength = getConstant(array.operands[1]);
+            member.arrayStride = (array.arrayStride > 0) ? array.arrayStride : getSize(elementId);
+        }
+        uint32_t scalarId = elementId;
+        member.componentCount = 1;
+        if (isValidId(elementId) && ids[elementId].opcode == OpTypeVector && ids[elementId].operands.size() >= 2)
+        {
+            scalarId = ids[elementId].operands[0];
+            member.componentCount = ids[elementId].operands[1];
+        }
+        if (!isValidId(scalarId))
+        {
+            return;
+        }
+
+        // int operands: width, signedness
+        const SpirvId& scalar = ids[scalarId];
+        if (scalar.opcode == OpTypeBool)
+        {
+            member.type = SpirvBlockMember::Type::boolType;
+        }
+        else if (scalar.opcode == OpTypeInt && scalar.operands.size() >= 2 && scalar.operands[0] == 32)
+        {
+            member.type = (scalar.operands[1] != 0) ?
+                SpirvBlockMember::Type::intType : SpirvBlockMember::Type::uintType;
+        }
+        else if (scalar.opcode == OpTypeFloat && !scalar.operands.empty() && scalar.operands[0] == 32)
+        {
+            member.type = SpirvBlockMember::Type::floatType;
+        }
+    }
+
+    std::vector<SpirvBlockMember> getMembers(const uint32_t structId) const
+    {
+        std::vector<SpirvBlockMember> members;
+        const SpirvId& type = ids[structId];
+        for (uint32_t idx = 0; idx < type.operands.size(); ++idx)
+        {
+            SpirvBlockMember member;
+            member.name = (idx < type.memberNames.size()) ? type.memberNames[idx] : "";
+            member.offset = getMemberOffset(type, idx);
+            member.size = getSize(type.operands[idx], getMemberMatrixStride(type, idx));
+            setMemberType(member, type.operands[idx]);
+            members.emplace_back(std::move(member));
+        }
+        return members;
+    }
+
+    std::vector<SpirvId> ids;
+    std::vector<uint32_t> variables;
+    std::vector<uint32_t> specConstants;
+    std::unordered_set<uint32_t> referencedIds;
+    bool valid = false;
+
+private:
+    static std::string getString(const uint32_t* const p_words, const uint32_t wordCount)
+    {
+        const char* const p_chars = reinterpret_cast<const char*>(p_words);
+        return std::string(p_chars, strnlen(p_chars, wordCount * sizeof(uint32_t)));
+    }
+
+    bool isValidId(const uint32_t id) const
+    {
+        return id < ids.size();
+    }
+
+    static void setMemberValue(std::vector<uint32_t>& values, const uint32_t member, const uint32_t value)
+    {
+        if (values.size() <= member)
+        {
+            values.resize(member + 1, 0);
+        }
+        values[member] = value;
+    }
+
+    bool parseDeclaration(const uint32_t opcode, const uint32_t* const p_words, const uint32_t operandCount)
+    {
+        switch (opcode)
+        {
+        case OpName:
+            if (operandCount < 1 || !isValidId(p_words[0]))
+            {
+                return false;
+            }
+            ids[p_words[0]].name = getString(p_words + 1, operandCount - 1);
+            break;
+        case OpMemberName:
+        {
+            if (operandCount < 2 || !isValidId(p_words[0]))
+            {
+                return false;
+            }
+            std::vector<std::string>& names = ids[p_words[0]].memberNames;
+            if (names.size() <= p_words[1])
+            {
+                names.resize(p_words[1] + 1);
+            }
+            names[p_words[1]] = getString(p_words + 2, operandCount - 2);
+        } break;
+        case OpDecorate:
+        {
+            if (operandCount < 2 || !isValidId(p_words[0]))
+            {
+                return false;
+            }
+            SpirvId& target = ids[p_words[0]];
+            const uint32_t value = (operandCount > 2) ? p_words[2] : 0;
+            switch (p_words[1])
+            {
+            case DecorationSpecId:          target.specId = value; break;
+            case DecorationBlock:           target.block = true; break;
+            case DecorationBufferBlock:     target.bufferBlock = true; break;
+            case DecorationArrayStride:     target.arrayStride = value; break;
+            case DecorationBinding:         target.binding = value; break;
+            case DecorationDescriptorSet:   target.set = value; break;
+            default: break;
+            }
+        } break;
+        case OpMemberDecorate:
+        {
+            if (operandCount < 3 || !isValidId(p_words[0]))
+            {
+                return false;
+            }
+            SpirvId& target = ids[p_words[0]];
+            const uint32_t value = (operandCount > 3) ? p_words[3] : 0;
+            if (p_words[2] == DecorationOffset)
+            {
+                setMemberValue(target.memberOffsets, p_words[1], value);
+            }
+            else if (p_words[2] == DecorationMatrixStride)
+            {
+                setMemberValue(target.memberMatrixStrides, p_words[1], value);
+            }
+        } break;
+        case OpTypeBool:
+        case OpTypeInt:
+        case OpTypeFloat:
+        case OpTypeVector:
+        case OpTypeMatrix:
+        case OpTypeImage:
+        case OpTypeSampler:
+        case OpTypeSampledImage:
+        case OpTypeArray:
+        case OpTypeRuntimeArray:
+        case OpTypeStruct:
+        case OpTypePointer:
+            // result id first
+            if (operandCount < 1 || !isValidId(p_words[0]))
+            {
+                return false;
+            }
+            ids[p_words[0]].opcode = opcode;
+            ids[p_words[0]].operands.assign(p_words + 1, p_words + operandCount);
+            break;
+        case OpConstant:
+        case OpSpecConstantTrue:
+        case OpSpecConstantFalse:
+        case OpSpecConstant:
+        case OpVariable:
+            // result type first, then result id
+            if (operandCount < 2 || !isValidId(p_words[1]))
+            {
+                return false;
+            }
+            ids[p_words[1]].opcode = opcode;
+            ids[p_words[1]].operands.assign(p_words, p_words + operandCount);
+            ids[p_words[1]].operands.erase(ids[p_words[1]].operands.begin() + 1);
+            if (opcode == OpVariable)
+            {
+                variables.push_back(p_words[1]);
+            }
+            else if (opcode != OpConstant)
+            {
+                specConstants.push_back(p_words[1]);
+            }
+            break;
+        default:
+            break;
+        }
+        return true;
+    }
+};
+
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ShaderReflection::addStage(const std::vector<uint32_t>& code, const VkShaderStageFlagBits stage)
+{
+    const SpirvModule module(code);
+    if (!module.valid)
+    {
+        std::cerr << "Invalid spir-v code, no reflection" << std::endl;
+        return false;
+    }
+
+    for (const uint32_t variableId : module.variables)
+    {
+        if (module.referencedIds.count(variableId) == 0)
+        {
+            continue;
+        }
+        // variable operands: pointer type, storage class
+        const SpirvId& variable = module.ids[variableId];
+        const uint32_t storageClass = variable.operands[1];
+        const SpirvId& pointerType = module.ids[variable.operands[0]];
+        if (pointerType.opcode != OpTypePointer)
+        {
+            continue;
+        }
+
+        // arrays of descriptors
+        uint32_t typeId = pointerType.operands[1];
+        uint32_t descriptorCount = 1;
+        if (module.ids[typeId].opcode == OpTypeArray)
+        {
+            descriptorCount = module.getConstant(module.ids[typeId].operands[1]);
+            typeId = module.ids[typeId].operands[0];
+        }
+        const SpirvId& type = module.ids[typeId];
+
+        if (storageClass == StorageClassPushConstant)
+        {
+            pushConstantSize = std::max(pushConstantSize, module.getSize(typeId));
+            pushConstantStageFlags |= stage;
+            if (pushConstantMembers.empty())
+            {
+                pushConstantMembers = module.getMembers(typeId);
+            }
+            continue;
+        }
+
+        SpirvDescriptor descriptor;
+        if (storageClass == StorageClassUniformConstant)
+        {
+            if (type.opcode == OpTypeSampledImage)
+            {
+                descriptor.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+                if (!type.operands.empty() && type.operands[0] < module.ids.size())
+                {
+                    const SpirvId& imageType = module.ids[type.operands[0]];
+                    if (imageType.opcode == OpTypeImage && imageType.operands.size() >= 4)
+                    {
+                        descriptor.imageViewType = getImageViewType(imageType.operands[1], imageType.operands[3] != 0);
+                    }
+                }
+            }
+            else if (type.opcode == OpTypeSampler)
+            {
+                descriptor.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+            }
+            else if (type.opcode == OpTypeImage)
+            {
+                // image operands: sampled type, dim, depth, arrayed, ms, sampled
+                const bool buffer = type.operands[1] == s_spirvDimBuffer;
+                const bool storage = type.operands[5] == 2;
+                descriptor.imageViewType = getImageViewType(type.operands[1], type.operands[3] != 0);
+                descriptor.descriptorType = buffer ?
+                    (storage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER) :
+                    (storage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE);
+            }
+        }
+        else if ((storageClass == StorageClassUniform || storageClass == StorageClassStorageBuffer)
+            && type.opcode == OpTypeStruct)
+        {
+            descriptor.descriptorType = (storageClass == StorageClassUniform && type.block) ?
+                VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            descriptor.blockSize = module.getSize(typeId);
+            descriptor.members = module.getMembers(typeId);
+        }
+        if (descriptor.descriptorType == VK_DESCRIPTOR_TYPE_MAX_ENUM)
+        {
+            continue;
+        }
+
+        descriptor.name = variable.name.empty() ? type.name : variable.name;
+        descriptor.set = variable.set;
+        descriptor.binding = variable.binding;
+        descriptor.descriptorCount = descriptorCount;
+        descriptor.stageFlags = stage;
+
+        // merge with the same binding of the other stages
+        auto iter = std::find_if(descriptors.begin(), descriptors.end(),
+            [&descriptor](const SpirvDescriptor& descriptorRef)
+        {
+            return descriptorRef.set == descriptor.set && descriptorRef.binding == descriptor.binding;
+        });
+        if (iter != descriptors.end())
+        {
+            iter->stageFlags |= stage;
+        }
+        else
+        {
+            descriptors.emplace_back(std::move(descriptor));
+        }
+    }
+
+    std::sort(descriptors.begin(), descriptors.end(),
+        [](const SpirvDescriptor& lhs, const SpirvDescriptor& rhs)
+    {
+        return (lhs.set != rhs.set) ? lhs.set < rhs.set : lhs.binding < rhs.binding;
+    });
+
+    for (const uint32_t constantId : module.specConstants)
+    {
+        // spec constant operands: result type, value words
+        const SpirvId& constant = module.ids[constantId];
+        if (constant.specId == ~0u || module.getSize(constant.operands[0]) > sizeof(uint32_t))
+        {
+            continue;
+        }
+        const bool defined = std::any_of(specConstants.begin(), specConstants.end(),
+            [&constant](const SpirvSpecConstant& specConstantRef)
+        {
+            return specConstantRef.constantId == constant.specId;
+        });
+        if (defined)
+        {
+            continue;
+        }
+
+        // int operands: width, signedness
+        const SpirvId& type = module.ids[constant.operands[0]];
+        SpirvSpecConstant specConstant;
+        specConstant.name = constant.name;
+        if (type.opcode == OpTypeBool)
+        {
+            specConstant.type = SpirvSpecConstant::Type::boolType;
+        }
+        else if (type.opcode == OpTypeInt)
+        {
+            specConstant.type = (type.operands[1] != 0) ?
+                SpirvSpecConstant::Type::intType : SpirvSpecConstant::Type::uintType;
+        }
+        specConstant.constantId = constant.specId;
+        if (constant.opcode == OpSpecConstant)
+        {
+            specConstant.defaultValue = (constant.operands.size() > 1) ? constant.operands[1] : 0;
+        }
+        else
+        {
+            specConstant.defaultValue = (constant.opcode == OpSpecConstantTrue) ? 1 : 0;
+        }
+        specConstants.emplace_back(std::move(specConstant));
+    }
+    std::sort(specConstants.begin(), specConstants.end(),
+        [](const SpirvSpecConstant& lhs, const SpirvSpecConstant& rhs)
+    {
+        return lhs.constantId < rhs.constantId;
+    });
+    return true;
+}
+
+const SpirvDescriptor* ShaderReflection::findDescriptor(const uint32_t set, const uint32_t binding) const
+{
+    for (const auto& descriptorRef : descriptors)
+    {
+        if (descriptorRef.set == set && descriptorRef.binding == binding)
+        {
+            return &descriptorRef;
+        }
+    }
+    return nullptr;
+}
+
+std::vector<VkDescriptorSetLayoutBinding> ShaderReflection::getSetLayoutBindings(const uint32_t set) const
+{
+    std::vector<VkDescriptorSetLayoutBinding> bindings;
+    for (const auto& descriptorRef : descriptors)
+    {
+        if (descriptorRef.set == set)
+        {
+            const VkDescriptorSetLayoutBinding descriptorSetLayoutBinding =
+            {
+                descriptorRef.binding,          // binding
+                descriptorRef.descriptorType,   // descriptorType
+                descriptorRef.descriptorCount,  // descriptorCount
+                descriptorRef.stageFlags,       // stageFlags
+                nullptr                         // pImmutableSamplers
+            };
+            bindings.push_back(descriptorSetLayoutBinding);
+        }
+    }
+    return bindings;
+}
+
+const SpirvBlockMember* findBlockMember(const std::vector<SpirvBlockMember>& members, const std::string& name)
+{
+    for (const auto& memberRef : members)
+    {
+        if (memberRef.name == name)
+        {
+            return &memberRef;
+        }
+    }
+    return nullptr;
+}
+
+static bool isOpInRange(const uint32_t opcode, const uint32_t first, const uint32_t last)
+{
+    return opcode >= first && opcode <= last;
+}
+
+static bool isAluOp(const uint32_t opcode)
+{
+    return isOpInRange(opcode, OpConvertFToU, OpBitcast)
+        || isOpInRange(opcode, OpSNegate, OpSMulExtended)
+        || isOpInRange(opcode, OpAny, OpFUnordGreaterThanEqual)
+        || isOpInRange(opcode, OpShiftRightLogical, OpBitCount)
+        || isOpInRange(opcode, OpDPdx, OpFwidthCoarse);
+}
+
+// Instructions whose result is a value kept in registers (result type and id first).
+static bool isValueOp(const uint32_t opcode)
+{
+    return isAluOp(opcode)
+        || opcode == OpExtInst
+        || isOpInRange(opcode, OpVectorShuffle, OpCompositeInsert)
+        || isOpInRange(opcode, OpImageSampleImplicitLod, OpImageRead)
+        || opcode == OpPhi
+        || opcode == OpLoad;
+}
+
+SpirvCost getSpirvCost(const std::vector<uint32_t>& code)
+{
+    SpirvCost cost;
+    const SpirvModule module(code);
+    if (!module.valid)
+    {
+        return cost;
+    }
+    cost.byteSize = (uint32_t)(code.size() * sizeof(uint32_t));
+
+    // live range of each value: first and last instruction index
+    struct LiveRange
+    {
+        uint32_t def        = ~0u;
+        uint32_t lastUse    = 0;
+        uint32_t componentCount = 0;
+    };
+    std::vector<LiveRange> ranges(module.ids.size());
+
+    uint32_t glslStd450Id = ~0u;
+    bool inFunctions = false;
+    size_t wordIndex = s_spirvHeaderWordCount;
+    while (wordIndex < code.size())
+    {
+        const uint32_t opcode = code[wordIndex] & 0xffff;
+        const uint32_t wordCount = code[wordIndex] >> 16;
+        const uint32_t* const p_words = &code[wordIndex + 1];
+        const uint32_t operandCount = wordCount - 1;
+        wordIndex += wordCount;
+
+        if (opcode == OpExtInstImport && operandCount >= 2
+            && strncmp(reinterpret_cast<const char*>(p_words + 1), "GLSL.std.450", operandCount * 4) == 0)
+        {
+            glslStd450Id = p_words[0];
+        }
+        if (opcode == OpFunction)
+        {
+            inFunctions = true;
+        }
+        if (!inFunctions)
+        {
+            continue;
+        }
+
+        const uint32_t instructionIndex = cost.instructionCount++;
+        if (opcode == OpExtInst && operandCount >= 4)
+        {
+            // operands: result type, result id, set, instruction
+            const bool transcendental = p_words[2] == glslStd450Id && isOpInRange(p_words[3],
+                s_glslStd450TranscendentalFirst, s_glslStd450TranscendentalLast);
+            ++(transcendental ? cost.transcendentalCount : cost.aluCount);
+        }
+        else if (isOpInRange(opcode, OpImageSampleImplicitLod, OpImageRead))
+        {
+            ++cost.textureSampleCount;
+        }
+        else if (isAluOp(opcode))
+        {
+            ++cost.aluCount;
+        }
+        else if (opcode == OpBranchConditional || opcode == OpSwitch)
+        {
+            ++cost.branchCount;
+        }
+        else if (opcode == OpLoopMerge)
+        {
+            ++cost.loopCount;
+        }
+
+        // any operand naming a value counts as a use, as in the reflection
+        for (uint32_t idx = 0; idx < operandCount; ++idx)
+        {
+            if (p_words[idx] < ranges.size() && ranges[p_words[idx]].def != ~0u)
+            {
+                ranges[p_words[idx]].lastUse = instructionIndex;
+            }
+        }
+        if (isValueOp(opcode) && operandCount >= 2 && p_words[1] < ranges.size())
+        {
+            LiveRange& range = ranges[p_words[1]];
+            range.def = instructionIndex;
+            range.lastUse = instructionIndex;
+            range.componentCount = module.getComponentCount(p_words[0]);
+        }
+    }
+
+    // values are live from their definition to their last use
+    std::vector<int32_t> liveDeltas(cost.instructionCount + 1, 0);
+    for (const LiveRange& range : ranges)
+    {
+        if (range.def != ~0u)
+        {
+            liveDeltas[range.def] += (int32_t)range.componentCount;
+            liveDeltas[range.lastUse + 1] -= (int32_t)range.componentCount;
+        }
+    }
+    int32_t liveCount = 0;
+    for (const int32_t delta : liveDeltas)
+    {
+        liveCount += delta;
+        cost.peakLiveScalarCount = std::max(cost.peakLiveScalarCount, (uint32_t)liveCount);
+    }
+    return cost;
+}
+
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,123 @@
+#ifndef CORE_SPIRV_REFLECTION_H
+#define CORE_SPIRV_REFLECTION_H
+
+// Copyright (c) 2017 Johannes Pystynen
+// This code is licensed under the MIT license (MIT)
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace core
+{
+
+// Member of a uniform or push constant block.
+struct SpirvBlockMember
+{
+    // 32-bit scalar type of scalar and vector members and of arrays of them
+    enum class Type : uint32_t
+    {
+        otherType   = 0, // matrices, structs, other widths
+        boolType    = 1,
+        intType     = 2,
+        uintType    = 3,
+        floatType   = 4,
+    };
+
+    std::string name;
+    uint32_t offset = 0;
+    uint32_t size   = 0;
+
+    Type type               = Type::otherType;
+    uint32_t componentCount = 0; // per array element
+    uint32_t arrayLength    = 1;
+    uint32_t arrayStride    = 0; // std140/std430 stride, 0 for non-arrays
+};
+
+// Descriptor used by the shader stages.
+struct SpirvDescriptor
+{
+    std::string name;   // variable name, block name for instance-less blocks
+    uint32_t set        = 0;
+    uint32_t binding    = 0;
+    VkDescriptorType descriptorType = VK_DESCRIPTOR_TYPE_MAX_ENUM;
+    uint32_t descriptorCount        = 1;
+    VkShaderStageFlags stageFlags   = 0;
+
+    VkImageViewType imageViewType   = VK_IMAGE_VIEW_TYPE_2D; // image descriptors
+
+    uint32_t blockSize  = 0; // uniform and storage buffers
+    std::vector<SpirvBlockMember> members;
+};
+
+// 32-bit scalar specialization constant (bool, int or float).
+struct SpirvSpecConstant
+{
+    enum class Type : uint32_t
+    {
+        boolType    = 0,
+        intType     = 1,
+        uintType    = 2,
+        floatType   = 3,
+    };
+
+    std::string name;
+    Type type              = Type::floatType;
+    uint32_t constantId    = 0;
+    uint32_t defaultValue  = 0; // bits of the declared value, 1 or 0 for bools
+};
+
+// Resources which the shader code actually references, declared but unused
+// resources are left out.
+class ShaderReflection
+{
+public:
+    // Adds the resources of one stage, returns false if the code is not valid spir-v.
+    bool addStage(const std::vector<uint32_t>& code, const VkShaderStageFlagBits stage);
+
+    // nullptr if the shader does not use the binding
+    const SpirvDescriptor* findDescriptor(const uint32_t set, const uint32_t binding) const;
+
+    // Layout bindings of the used descriptors of the set.
+    std::vector<VkDescriptorSetLayoutBinding> getSetLayoutBindings(const uint32_t set) const;
+
+    std::vector<SpirvDescriptor> descriptors; // sorted by set and binding
+
+    uint32_t pushConstantSize                   = 0;
+    VkShaderStageFlags pushConstantStageFlags   = 0;
+    std::vector<SpirvBlockMember> pushConstantMembers;
+
+    std::vector<SpirvSpecConstant> specConstants; // sorted by constant id
+};
+
+// nullptr if the block does not have the member
+const SpirvBlockMember* findBlockMember(const std::vector<SpirvBlockMember>& members, const std::string& name);
+
+// Static cost estimate of one stage, counts are instructions in the function bodies
+// and are not weighted by vector width.
+struct SpirvCost
+{
+    uint32_t instructionCount       = 0;
+    uint32_t aluCount               = 0; // arithmetic, conversion, compare, logic and bit ops
+    uint32_t transcendentalCount    = 0; // sin, pow, exp, log, sqrt... (GLSL.std.450)
+    uint32_t textureSampleCount     = 0; // sample, fetch and gather
+    uint32_t branchCount            = 0; // conditional branches and switches
+    uint32_t loopCount              = 0;
+    // register pressure estimate: most 32-bit values live at once in instruction order
+    // (values kept live by loop back edges are not counted)
+    uint32_t peakLiveScalarCount    = 0;
+    uint32_t byteSize               = 0;
+};
+
+// Returns a zero cost if the code is not valid spir-v.
+SpirvCost getSpirvCost(const std::vector<uint32_t>& code);
+
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif // CORE_SPIRV_REFLECTION_H
@@ -0,0 +1,67 @@
+#ifndef CORE_SPSC_QUEUE_H
+#define CORE_SPSC_QUEUE_H
+
+// Copyright (c) 2017 Johannes Pystynen
+// This code is licensed under the MIT license (MIT)
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace core
+{
+
+// Lock-free bounded queue for one producer thread and one consumer thread.
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+        "SpscQueue capacity needs to be a power of two");
+public:
+    SpscQueue() = default;
+    ~SpscQueue() = default;
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer only. Returns false if the queue is full.
+    bool tryPush(T&& item)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == Capacity)
+        {
+            return false;
+        }
+        m_items[tail & (Capacity - 1)] = std::move(item);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. Returns false if the queue is empty.
+    bool tryPop(T& item)
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        item = std::move(m_items[head & (Capacity - 1)]);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    T m_items[Capacity];
+
+    // separate cache lines, written by different threads
+    alignas(64) std::atomic<size_t> m_head{ 0 }; // consumer
+    alignas(64) std::atomic<size_t> m_tail{ 0 }; // producer
+};
+
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif // CORE_SPSC_QUEUE_H
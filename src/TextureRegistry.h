@@ -0,0 +1,106 @@
+#ifndef CORE_TEXTURE_REGISTRY_H
+#define CORE_TEXTURE_REGISTRY_H
+
+// Copyright (c) 2017 Johannes Pystynen
+// This code is licensed under the MIT license (MIT)
+
+#include "GpuImage.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <tuple>
+
+#include <vulkan/vulkan.h>
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace core
+{
+
+// Channel images by file content, channels loading identical files share one image.
+// Only weak references are kept: an image is freed when no channel or
+// frame in flight (retired channels) holds it anymore.
+class TextureRegistry
+{
+public:
+    // The hash alone is not trusted, a collision also needs equal file sizes and image extent.
+    struct Key
+    {
+        uint64_t contentHash        = 0; // of all layer files
+        uint64_t byteSize           = 0; // of all layer files
+        uint32_t width              = 0;
+        uint32_t height             = 0;
+        uint32_t depth              = 0;
+        VkImageViewType viewType    = VK_IMAGE_VIEW_TYPE_2D;
+        VkFormat format             = VK_FORMAT_UNDEFINED;
+
+        bool operator<(const Key& other) const
+        {
+            return std::tie(contentHash, byteSize, width, height, depth, viewType, format)
+                < std::tie(other.contentHash, other.byteSize, other.width, other.height, other.depth,
+                    other.viewType, other.format);
+        }
+    };
+
+    // Returns nullptr if no live image has the key.
+    std::shared_ptr<GpuImage> find(const Key& key)
+    {
+        const auto iter = m_images.find(key);
+        if (iter == m_images.end())
+        {
+            return nullptr;
+        }
+        std::shared_ptr<GpuImage> image = iter->second.lock();
+        if (!image)
+        {
+            m_images.erase(iter);
+        }
+        return image;
+    }
+
+    // Marks the key as being decoded, false if another upload is already decoding it
+    // (channels loaded in parallel wait for the first one).
+    bool beginLoad(const Key& key)
+    {
+        return m_loading.insert(key).second;
+    }
+
+    // Ends beginLoad, image is nullptr if the load failed.
+    void endLoad(const Key& key, const std::shared_ptr<GpuImage>& image)
+    {
+        m_loading.erase(key);
+        if (image)
+        {
+            add(key, image);
+        }
+    }
+
+private:
+    void add(const Key& key, const std::shared_ptr<GpuImage>& image)
+    {
+        // drop the freed images, the registry holds at most the channel count of live images
+        for (auto iter = m_images.begin(); iter != m_images.end();)
+        {
+            if (iter->second.expired())
+            {
+                iter = m_images.erase(iter);
+            }
+            else
+            {
+                ++iter;
+            }
+        }
+        m_images[key] = image;
+    }
+
+    std::map<Key, std::weak_ptr<GpuImage> > m_images;
+    std::set<Key> m_loading;
+};
+
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif // CORE_TEXTURE_REGISTRY_H
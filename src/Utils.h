@@ -4,6 +4,8 @@
 // Copyright (c) 2017 Johannes Pystynen
 // This code is licensed under the MIT license (MIT)
 
+#include "ShaderCompiler.h"
+
 #include <cstdint>
 #include <string>
 
@@ -35,6 +37,17 @@ public:
     uint32_t windowWidth            = 1280;
     uint32_t windowHeight           = 720;
 
+    // Session-constant shader inputs (iResolution, iChannelResolution, iSampleRate)
+    // are specialization constants, the pipeline is rebuilt when they change.
+    bool specializeConstantInputs   = false;
+
+    // Per-frame shader inputs are push constants instead of the set 0 binding 2 uniform block,
+    // the draw commands are then recorded every frame.
+    bool pushConstantInputs         = false;
+
+    // spirv-tools passes for the compiled glsl (none, size or performance)
+    ShaderOptimization shaderOptimization = ShaderOptimization::performance;
+
 private:
     GlobalVariables() = default;
     ~GlobalVariables() = default;
@@ -7,6 +7,7 @@
 #include <assert.h>
 #include <tuple>
 #include <algorithm>
+#include <cstdio>
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -95,10 +96,21 @@ void Window::update()
         }
 
         updateMousePos(msg.message);
+        updatePresetKey(msg);
         checkForResize();
     }
 }
 
+void Window::waitForMessages(const uint32_t timeoutMillis)
+{
+    MsgWaitForMultipleObjectsEx(
+        0,                      // nCount
+        nullptr,                // pHandles
+        timeoutMillis,          // dwMilliseconds
+        QS_ALLINPUT,            // dwWakeMask
+        MWMO_INPUTAVAILABLE);   // dwFlags
+}
+
 bool Window::shouldClose() const
 {
     return m_closeWindow;
@@ -134,8 +146,8 @@ void Window::updateMousePos(const uint32_t message)
         {
             if (ScreenToClient(m_hwnd, &point))
             {
-                m_mousePos.leftPosX = std::min((uint32_t)std::max(0l, point.x), m_width);
-                m_mousePos.leftPosY = std::min((uint32_t)std::max(0l, point.y), m_height);
+                m_mousePos.leftPosX = std::min((uint32_t)std::max(0l, point.x), m_width.load());
+                m_mousePos.leftPosY = std::min((uint32_t)std::max(0l, point.y), m_height.load());
                 m_mousePos.clickLeft = 1;
             }
         }
@@ -174,11 +186,27 @@ void Window::resizeHandled()
     m_resized = false;
 }
 
-void Window::updateWindowText(const std::string& text)
+void Window::updatePresetKey(const MSG& msg)
+{
+    if (msg.message == WM_KEYDOWN && msg.wParam >= '1' && msg.wParam <= '9')
+    {
+        m_presetKey = (int32_t)(msg.wParam - '1');
+    }
+}
+
+int32_t Window::takePresetKey()
+{
+    const int32_t key = m_presetKey;
+    m_presetKey = -1;
+    return key;
+}
+
+void Window::updateWindowText(const char* const text)
 {
-    const std::string fullText = m_name + "  " + std::to_string(m_width)
-        + "x" + std::to_string(m_height) + text;
-    const BOOL res = SetWindowText(m_hwnd, fullText.c_str());
+    char fullText[256];
+    snprintf(fullText, sizeof(fullText), "%s  %ux%u%s",
+        m_name.c_str(), m_width.load(), m_height.load(), text);
+    const BOOL res = SetWindowText(m_hwnd, fullText);
 }
 
 HWND Window::getHwnd() const
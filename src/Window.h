@@ -4,6 +4,7 @@
 // Copyright (c) 2017 Johannes Pystynen
 // This code is licensed under the MIT license (MIT)
 
+#include <atomic>
 #include <cstdint>
 #include <string>
 #include <tuple>
@@ -33,6 +34,8 @@ public:
     Window& operator=(const Window&) = delete;
 
     void update();
+    // Blocks until there are window messages or the timeout has passed.
+    void waitForMessages(const uint32_t timeoutMillis);
     bool shouldClose() const;
 
     uint32_t getWidth() const;
@@ -45,21 +48,28 @@ public:
     bool isResized() const;
     void resizeHandled();
 
-    void updateWindowText(const std::string& text);
+    // Index of the last pressed number key 1-9, -1 if none since the last call.
+    int32_t takePresetKey();
+
+    // Appends text to the name and size, does not allocate.
+    void updateWindowText(const char* const text);
 
 private:
     void checkForResize();
     void updateMousePos(const uint32_t message);
+    void updatePresetKey(const MSG& msg);
 
     HWND m_hwnd;
     HINSTANCE m_hinstance;
 
-    uint32_t m_width    = 0;
-    uint32_t m_height   = 0;
+    // read by the render thread when the swapchain is recreated
+    std::atomic<uint32_t> m_width   { 0 };
+    std::atomic<uint32_t> m_height  { 0 };
 
     MousePos m_mousePos{};
 
     bool m_resized = false;
+    int32_t m_presetKey = -1;
 
     std::string m_name;
     bool m_closeWindow = false;